@@ -0,0 +1,45 @@
+#!/bin/sh
+# Compare the time and size of raster outputs of the same maze.
+#
+#   bench/raster.sh [svgmaze] [width] [height] [cell pixels]
+#
+# QOI and GIF are drawn by svgmaze itself. PNG is drawn from the SVG output
+# by rsvg-convert or ImageMagick, when either is installed.
+set -eu
+
+SVGMAZE=${1:-./build/svgmaze}
+W=${2:-500}
+H=${3:-500}
+C=${4:-4}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+ms() {
+    echo $(($(date +%s%N) / 1000000))
+}
+
+# run <name> <file> <command...>: time a command writing <file>
+run() {
+    name=$1
+    file=$2
+    shift 2
+    t0=$(ms)
+    "$@" > "$file"
+    t1=$(ms)
+    printf '%-8s %8s ms %12s bytes\n' "$name" $((t1 - t0)) \
+        "$(wc -c < "$file" | tr -d ' ')"
+}
+
+echo "${W}x${H} maze, ${C} pixels per grid cell"
+run qoi "$TMP/maze.qoi" "$SVGMAZE" -w"$W" -h"$H" -c"$C" -oqoi
+run gif "$TMP/maze.gif" "$SVGMAZE" -w"$W" -h"$H" -c"$C" -ogif --frames=1
+
+# Corridors span two grid cells, so the image comes out the same size.
+"$SVGMAZE" -w"$W" -h"$H" -c$((2 * C)) -p"$C" -osvg > "$TMP/maze.svg"
+if command -v rsvg-convert > /dev/null; then
+    run png "$TMP/maze.png" rsvg-convert "$TMP/maze.svg"
+elif command -v magick > /dev/null; then
+    run png "$TMP/maze.png" magick "$TMP/maze.svg" png:-
+else
+    echo "png      skipped, needs rsvg-convert or ImageMagick"
+fi
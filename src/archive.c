@@ -0,0 +1,179 @@
+/** @brief Compact maze archives implementation */
+#include "archive.h"
+
+#include "codec.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARCHIVE_MAGIC "SVMA"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_HEADER 32
+
+/* Walk directions match the generator: east, west, south, north. */
+static const int archive_dx[4] = {1, -1, 0, 0};
+static const int archive_dy[4] = {0, 0, 1, -1};
+
+
+/* Is the wall on side `d` of corridor cell `x`, `y` open? */
+static inline int archive_open(const grid *maze, u32 x, u32 y, u32 d) {
+    return !grid_get(maze, (u32)((i64)x * 2 + 1 + archive_dx[d]),
+                     (u32)((i64)y * 2 + 1 + archive_dy[d]));
+}
+
+/**
+ * Choose the walk's next move through `maze`: the first open passage to an
+ * unvisited cell in coding order, else back, else WALK_END. A passage to a
+ * visited cell other than back is a loop, and ends the walk with -1.
+ */
+static int archive_next(const struct walk_state *ws, const grid *maze,
+                        int entered) {
+    const u32 options = walk_options(ws);
+    const int back = ws->depth ? (ws->stack[ws->depth - 1] ^ 1) : -1;
+    u8 order[4];
+    walk_candidates(ws, order);
+
+    int move = -1;
+    for (u32 k = 0; k < 4; ++k) {
+        const u32 d = order[k];
+        if ((int)d == back) {
+            continue;
+        }
+        const i64 nx = (i64)ws->x + archive_dx[d];
+        const i64 ny = (i64)ws->y + archive_dy[d];
+        if (nx < 0 || nx >= ws->columns || ny < 0 || ny >= ws->rows ||
+            !archive_open(maze, ws->x, ws->y, d)) {
+            continue;
+        }
+        if (!(options & (1u << d))) {
+            /* Loops are only looked for on entering a cell. */
+            if (entered) {
+                return -1;
+            }
+            continue;
+        }
+        if (move < 0) {
+            move = (int)d;
+            if (!entered) {
+                break;
+            }
+        }
+    }
+    if (move < 0) {
+        move = (back >= 0) ? back : WALK_END;
+    }
+    return move;
+}
+
+i64 archive_write(FILE *out, const grid *maze, u64 seed) {
+    const u32 columns = (maze->columns - 1) / 2;
+    const u32 rows = (maze->rows - 1) / 2;
+
+    struct walk_state ws;
+    if (walk_init(&ws, columns, rows, 0, 0) != 0) {
+        fprintf(stderr, "Unable to allocate memory for archive encoder\n");
+        return -1;
+    }
+
+    TRACE_BEGIN("encode");
+    struct rc_encoder rc;
+    rc_encoder_init(&rc);
+    u64 cells = 1;
+    int entered = 1;
+    int loop = 0;
+    int err = 0;
+    for (;;) {
+        int move = archive_next(&ws, maze, entered);
+        if (move < 0 || move == WALK_END) {
+            loop = (move < 0);
+            break;
+        }
+        entered = walk_encode(&ws, &rc, (u32)move);
+        if (entered < 0) {
+            err = 1;
+            break;
+        }
+        cells += (u64)entered;
+    }
+    err |= rc_encoder_finish(&rc) != 0;
+    walk_free(&ws);
+    TRACE_END("encode");
+
+    if (err) {
+        fprintf(stderr, "Unable to allocate memory for archive encoder\n");
+        rc_encoder_free(&rc);
+        return -1;
+    }
+    if (loop || cells != (u64)columns * rows) {
+        fprintf(stderr, "Unable to archive a maze that is not perfect\n");
+        rc_encoder_free(&rc);
+        return -1;
+    }
+
+    u8 header[ARCHIVE_HEADER] = {0};
+    memcpy(header, ARCHIVE_MAGIC, 4);
+    header[4] = ARCHIVE_VERSION;
+    codec_put_le(header + 8, columns, 4);
+    codec_put_le(header + 12, rows, 4);
+    codec_put_le(header + 16, seed, 8);
+    codec_put_le(header + 24, rc.len, 8);
+
+    fwrite(header, 1, ARCHIVE_HEADER, out);
+    fwrite(rc.buf, 1, rc.len, out);
+    i64 n = ARCHIVE_HEADER + (i64)rc.len;
+    rc_encoder_free(&rc);
+    return n;
+}
+
+int archive_read(FILE *in, grid **maze, u64 *seed) {
+    u8 header[ARCHIVE_HEADER];
+    size_t got = fread(header, 1, ARCHIVE_HEADER, in);
+    if (got == 0 && feof(in)) {
+        return 0;
+    }
+    if (got != ARCHIVE_HEADER || memcmp(header, ARCHIVE_MAGIC, 4) != 0 ||
+        header[4] != ARCHIVE_VERSION) {
+        fprintf(stderr, "Not a maze archive\n");
+        return -1;
+    }
+
+    const u32 columns = (u32)codec_get_le(header + 8, 4);
+    const u32 rows = (u32)codec_get_le(header + 12, 4);
+    const u64 len = codec_get_le(header + 24, 8);
+    *seed = codec_get_le(header + 16, 8);
+    if (columns == 0 || rows == 0 ||
+        columns > UINT32_MAX / 2 || rows > UINT32_MAX / 2) {
+        fprintf(stderr, "Corrupt maze archive\n");
+        return -1;
+    }
+
+    u8 *coded = malloc(len ? len : 1);
+    if (coded == NULL || fread(coded, 1, len, in) != len) {
+        fprintf(stderr, "Unable to read maze archive\n");
+        free(coded);
+        return -1;
+    }
+
+    grid *g = grid_alloc_kind(columns * 2 + 1, rows * 2 + 1, 1, GRID_BYTES);
+    struct walk_state ws;
+    int err = (g == NULL) || walk_init(&ws, columns, rows, 0, 0) != 0;
+    if (!err) {
+        TRACE_BEGIN("decode");
+        struct rc_decoder rc;
+        rc_decoder_init(&rc, coded, len);
+
+        /* Every cell but the first is carved once and backtracked once. */
+        err = walk_decode_grid(&ws, &rc, g, 2 * (u64)columns * rows) != 0;
+        walk_free(&ws);
+        TRACE_END("decode");
+    }
+    free(coded);
+
+    if (err) {
+        fprintf(stderr, "Unable to decode maze archive\n");
+        grid_free(g);
+        return -1;
+    }
+    *maze = g;
+    return 1;
+}
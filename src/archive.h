@@ -0,0 +1,44 @@
+/**
+ * @brief Compact maze archives
+ *
+ * Store finished mazes as a range coded depth first walk of their spanning
+ * tree, about 1.5 bits per corridor cell. Unlike recordings, any perfect
+ * maze can be archived, and mazes are rebuilt without the generator, so
+ * archives outlive changes to the generation algorithm.
+ *
+ * An archive is a sequence of entries, so archives can be concatenated.
+ * Each entry, integers little endian:
+ *   "SVMA" version:u8 0:u8[3] columns:u32 rows:u32 seed:u64 length:u64
+ *   coded:u8[length]
+ *
+ * The walk starts in the top left corridor cell and, at each cell, takes
+ * the first open passage to an unvisited cell in the codec's candidate
+ * order before backtracking.
+ */
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdio.h>
+
+#include "types.h"
+#include "grid.h"
+
+/**
+ * Encode `maze`, a grid as made by `maze_generate`, and write it to `out`
+ * as an archive entry tagged with `seed`.
+ *
+ * @return Number of bytes written, or -1 if the maze is not a perfect maze
+ *         or memory ran out.
+ */
+i64 archive_write(FILE *out, const grid *maze, u64 seed);
+
+/**
+ * Read the next entry of an archive from `in`, rebuilding its maze into a
+ * new byte grid in `maze` and its seed into `seed`.
+ *
+ * @return 1 if a maze was read, 0 at the end of the archive, or -1 if the
+ *         entry is invalid or unreadable.
+ */
+int archive_read(FILE *in, grid **maze, u64 *seed);
+
+#endif /* ARCHIVE_H */
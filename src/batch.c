@@ -0,0 +1,550 @@
+/** @brief Batch runs implementation */
+#include "batch.h"
+
+#include "maze.h"
+#include "pool.h"
+#include "stats.h"
+#include "strings.h"
+#include "timer.h"
+#include "trace.h"
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Output buffer per worker, large enough to batch writes to disk. */
+#define BATCH_BUFFER (1u << 20)
+
+/* Mazes of at least this many cells are drawn in bands across threads. */
+#define BATCH_POSTER_CELLS (1u << 20)
+
+/* Bands per thread of a large maze, so that uneven bands even out. */
+#define BATCH_BANDS_PER_THREAD 4
+
+/* FNV-1a 64 bit parameters, for the manifest. */
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+/* Mazes of one size with consecutive seeds, a line of a job file. */
+struct batch_line {
+    u32 columns;
+    u32 rows;
+    u64 seed;
+    u64 count;
+    /* Position of the first maze in the manifest. */
+    u64 index;
+};
+
+/* A large maze, generated by one task then drawn in bands by many. */
+struct batch_poster {
+    const struct maze_job *job;
+    grid *maze;
+    u32 bands;
+    char **bufs;
+    size_t *lens;
+    atomic_ullong render_ns;
+    atomic_uint failed;
+};
+
+struct batch {
+    struct maze_job job;
+    const struct batch_opts *opts;
+
+    /* Lines of the batch run here, and the number of mazes in them. */
+    struct batch_line *lines;
+    u64 nlines;
+    u64 count;
+    /* Output hash of each maze for the manifest, or NULL without one. */
+    u64 *hashes;
+    u8 *written;
+
+    atomic_uint failed;
+};
+
+/* A line of the batch, as a pool task. */
+struct batch_task {
+    struct batch *b;
+    const struct batch_line *line;
+};
+
+static atomic_int report_requested = 0;
+
+static void batch_on_sigusr1(int sig) {
+    (void)sig;
+    atomic_store(&report_requested, 1);
+}
+
+static void batch_path(char *path, size_t size, const struct batch *b,
+                       u32 columns, u32 rows, u64 seed) {
+    /* Sizes vary between the lines of a job file, so name them. */
+    if (b->opts->jobs) {
+        snprintf(path, size, "%s/%ux%u-%llu.%s", b->opts->dir, columns, rows,
+                 (unsigned long long)seed, job_extension(b->job.output));
+        return;
+    }
+    snprintf(path, size, "%s/%llu.%s", b->opts->dir,
+             (unsigned long long)seed, job_extension(b->job.output));
+}
+
+/* Hash the written file, it is still in the page cache. */
+static int batch_hash(const char *path, char *buffer, u64 *hash) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return -1;
+    }
+
+    u64 h = FNV_OFFSET;
+    size_t len;
+    while ((len = fread(buffer, 1, BATCH_BUFFER, in)) > 0) {
+        for (size_t k = 0; k < len; ++k) {
+            h = (h ^ (u8)buffer[k]) * FNV_PRIME;
+        }
+    }
+    int err = ferror(in);
+    fclose(in);
+    if (err) {
+        fprintf(stderr, "Unable to read %s\n", path);
+        return -1;
+    }
+    *hash = h;
+    return 0;
+}
+
+/* Add the written file at `index` to the manifest, if there is one. */
+static int batch_manifest_add(struct batch *b, const char *path, u64 index,
+                              char *buffer) {
+    if (b->hashes == NULL) {
+        return 0;
+    }
+    TRACE_BEGIN("hash");
+    int err = batch_hash(path, buffer, &b->hashes[index]);
+    TRACE_END("hash");
+    if (err) {
+        return -1;
+    }
+    b->written[index] = 1;
+    return 0;
+}
+
+/* --- Mazes --- */
+
+/* Write one maze of the batch to its file. */
+static int batch_one(struct batch *b, const struct maze_job *job, u64 index,
+                     struct stats *st, char *buffer) {
+    char path[4096];
+    batch_path(path, sizeof(path), b, job->columns, job->rows, job->seed);
+
+    u64 t0 = timer_ns();
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return -1;
+    }
+    setvbuf(out, buffer, _IOFBF, BATCH_BUFFER);
+
+    TRACE_BEGIN_ARG("maze", job->seed);
+    i64 n = job_run(job, out, st);
+
+    u64 t1 = timer_ns();
+    TRACE_BEGIN("flush");
+    int err = fclose(out);
+    TRACE_END("flush");
+    TRACE_END("maze");
+    u64 t2 = timer_ns();
+
+    if (n < 0 || err != 0) {
+        fprintf(stderr, "Unable to write %s\n", path);
+        return -1;
+    }
+    if (st) {
+        stats_record(st, STATS_WRITE, t2 - t1);
+        stats_record(st, STATS_TOTAL, t2 - t0);
+        stats_maze(st, (u64)n);
+    }
+    return batch_manifest_add(b, path, index, buffer);
+}
+
+static void batch_band(u64 begin, u64 end, void *arg) {
+    struct batch_poster *p = arg;
+    for (u64 band = begin; band < end; ++band) {
+        u64 t0 = timer_ns();
+        TRACE_BEGIN_ARG("band", band);
+        FILE *out = open_memstream(&p->bufs[band], &p->lens[band]);
+        if (out == NULL ||
+            job_draw_band(p->job, p->maze, out, (u32)band, p->bands) < 0 ||
+            fclose(out) != 0) {
+            fprintf(stderr, "Unable to draw band %llu of maze %llu\n",
+                    (unsigned long long)band,
+                    (unsigned long long)p->job->seed);
+            atomic_fetch_add(&p->failed, 1);
+        }
+        TRACE_END("band");
+        atomic_fetch_add(&p->render_ns, timer_ns() - t0);
+    }
+}
+
+/* Draw a generated large maze in bands across the pool, then join them
+ * into its file. */
+static int batch_poster(struct batch *b, const struct maze_job *job,
+                        grid *maze, u64 index, u64 t0, struct stats *st,
+                        char *buffer) {
+    struct batch_poster p = {
+        .job = job,
+        .maze = maze,
+        .bands = pool_threads() * BATCH_BANDS_PER_THREAD,
+    };
+    atomic_init(&p.render_ns, 0);
+    atomic_init(&p.failed, 0);
+    p.bufs = calloc(p.bands, sizeof(char *));
+    p.lens = calloc(p.bands, sizeof(size_t));
+    int err = (p.bufs == NULL || p.lens == NULL);
+    if (err) {
+        fprintf(stderr, "Unable to allocate memory for %u bands\n", p.bands);
+    } else {
+        pool_for(0, p.bands, 1, batch_band, &p);
+        err = (atomic_load(&p.failed) != 0);
+    }
+    grid_free(maze);
+
+    char path[4096];
+    batch_path(path, sizeof(path), b, job->columns, job->rows, job->seed);
+    u64 t1 = timer_ns();
+    u64 n = 0;
+    if (!err) {
+        TRACE_BEGIN("flush");
+        FILE *out = fopen(path, "w");
+        err = (out == NULL);
+        for (u32 k = 0; out && k < p.bands; ++k) {
+            err |= (fwrite(p.bufs[k], 1, p.lens[k], out) != p.lens[k]);
+            n += p.lens[k];
+        }
+        err |= (out && fclose(out) != 0);
+        TRACE_END("flush");
+        if (err) {
+            fprintf(stderr, "Unable to write %s\n", path);
+        }
+    }
+    u64 t2 = timer_ns();
+
+    for (u32 k = 0; p.bufs && k < p.bands; ++k) {
+        free(p.bufs[k]);
+    }
+    free(p.bufs);
+    free(p.lens);
+    if (err) {
+        return -1;
+    }
+
+    if (st) {
+        stats_record(st, STATS_RENDER, atomic_load(&p.render_ns));
+        stats_record(st, STATS_WRITE, t2 - t1);
+        stats_record(st, STATS_TOTAL, t2 - t0);
+        stats_maze(st, n);
+    }
+    return batch_manifest_add(b, path, index, buffer);
+}
+
+static int batch_maze(struct batch *b, const struct batch_line *line, u64 k,
+                      char *buffer) {
+    struct maze_job job = b->job;
+    job.columns = line->columns;
+    job.rows = line->rows;
+    job.seed = line->seed + k;
+    const u64 index = line->index + k;
+
+    if (pool_threads() > 1 &&
+        (u64)line->columns * line->rows >= BATCH_POSTER_CELLS) {
+        u64 t0 = timer_ns();
+        grid *maze = NULL;
+        TRACE_BEGIN_ARG("maze", job.seed);
+        int split = job_generate(&job, &maze, stats_thread());
+        TRACE_END("maze");
+        if (split < 0) {
+            return -1;
+        }
+        if (split > 0) {
+            /* Waiting for bands may run other mazes on this thread. */
+            return batch_poster(b, &job, maze, index, t0, stats_thread(),
+                                buffer);
+        }
+    }
+    return batch_one(b, &job, index, stats_thread(), buffer);
+}
+
+static void batch_mazes(u64 begin, u64 end, void *arg) {
+    struct batch_task *task = arg;
+    for (u64 k = begin; k < end; ++k) {
+        /* Per maze, as a wait inside a maze may start another here. */
+        char *buffer = malloc(BATCH_BUFFER);
+        if (buffer == NULL ||
+            batch_maze(task->b, task->line, k, buffer) != 0) {
+            atomic_fetch_add(&task->b->failed, 1);
+        }
+        free(buffer);
+
+        if (atomic_exchange(&report_requested, 0)) {
+            stats_report(stdout);
+        }
+    }
+}
+
+/* Split a line's run of mazes across the pool. */
+static void batch_line(void *arg) {
+    struct batch_task *task = arg;
+    pool_for(0, task->line->count, 1, batch_mazes, task);
+}
+
+/* --- Batch setup --- */
+
+/* List the mazes written, in job order. */
+static int batch_manifest(const struct batch *b) {
+    const struct batch_opts *opts = b->opts;
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/manifest-%llu-of-%llu.tsv", opts->dir,
+             (unsigned long long)opts->shard,
+             (unsigned long long)opts->shards);
+
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return -1;
+    }
+    for (u64 l = 0; l < b->nlines; ++l) {
+        const struct batch_line *line = &b->lines[l];
+        for (u64 k = 0; k < line->count; ++k) {
+            if (!b->written[line->index + k]) {
+                continue;
+            }
+            const u64 seed = line->seed + k;
+            char file[4096];
+            batch_path(file, sizeof(file), b, line->columns, line->rows, seed);
+            fprintf(out, "%llu\t%s\t%016llx\n", (unsigned long long)seed,
+                    file, (unsigned long long)b->hashes[line->index + k]);
+        }
+    }
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Unable to write %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Read a job file: one `<columns>x<rows> <seed>[..<last>]` line per run of
+ * mazes. Blank lines and lines starting with '#' are skipped.
+ */
+static int batch_load(const char *path, struct batch_line **lines, u64 *n) {
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return -1;
+    }
+
+    u64 cap = 0;
+    *lines = NULL;
+    *n = 0;
+    char text[256];
+    for (u64 number = 1; fgets(text, sizeof(text), in); ++number) {
+        char seeds[128];
+        struct batch_line line = {0};
+        if (text[0] == '#' || strspn(text, " \t\r\n") == strlen(text)) {
+            continue;
+        }
+        unsigned long long columns, rows;
+        if (sscanf(text, "%llux%llu %127s", &columns, &rows, seeds) != 3 ||
+            columns == 0 || rows == 0 ||
+            columns > MAZE_MAX_SIDE || rows > MAZE_MAX_SIDE) {
+            fprintf(stderr, "Unable to parse %s:%llu\n", path,
+                    (unsigned long long)number);
+            goto fail;
+        }
+        line.columns = (u32)columns;
+        line.rows = (u32)rows;
+
+        u64 last;
+        char *end = NULL;
+        int range = strrange(seeds, &line.seed, &last);
+        if (range > 0) {
+            line.seed = last = strtoull(seeds, &end, 10);
+        }
+        /* A range of every seed has a count too large to hold. */
+        if (range < 0 || (end && *end != '\0') ||
+            last - line.seed == UINT64_MAX) {
+            fprintf(stderr, "Unable to parse %s:%llu\n", path,
+                    (unsigned long long)number);
+            goto fail;
+        }
+        line.count = last - line.seed + 1;
+
+        if (*n == cap) {
+            cap = cap ? cap * 2 : 16;
+            struct batch_line *grown = realloc(*lines, sizeof(**lines) * cap);
+            if (grown == NULL) {
+                fprintf(stderr, "Unable to allocate memory for jobs\n");
+                goto fail;
+            }
+            *lines = grown;
+        }
+        (*lines)[(*n)++] = line;
+    }
+    fclose(in);
+    return 0;
+
+fail:
+    fclose(in);
+    free(*lines);
+    *lines = NULL;
+    return -1;
+}
+
+/**
+ * Cut the lines down to this shard's slice, a contiguous run of the mazes
+ * in job order. The first `total % shards` shards take one more maze than
+ * the rest.
+ */
+static void batch_slice(struct batch *b) {
+    const struct batch_opts *opts = b->opts;
+    u64 total = 0;
+    for (u64 l = 0; l < b->nlines; ++l) {
+        total += b->lines[l].count;
+    }
+
+    u64 first = 0;
+    u64 count = total;
+    if (opts->shards) {
+        const u64 size = total / opts->shards;
+        const u64 extra = total % opts->shards;
+        first = opts->shard * size +
+                (opts->shard < extra ? opts->shard : extra);
+        count = size + (opts->shard < extra);
+    }
+
+    const u64 last = first + count;
+    u64 pos = 0;
+    u64 kept = 0;
+    for (u64 l = 0; l < b->nlines; ++l) {
+        struct batch_line line = b->lines[l];
+        const u64 end = pos + line.count;
+        const u64 lo = (first > pos) ? first : pos;
+        const u64 hi = (last < end) ? last : end;
+        if (lo < hi) {
+            line.seed += lo - pos;
+            line.count = hi - lo;
+            line.index = b->count;
+            b->count += line.count;
+            b->lines[kept++] = line;
+        }
+        pos = end;
+    }
+    b->nlines = kept;
+}
+
+static int batch_line_larger(const void *a, const void *b) {
+    const struct batch_line *x = *(struct batch_line * const *)a;
+    const struct batch_line *y = *(struct batch_line * const *)b;
+    const u64 cx = (u64)x->columns * x->rows;
+    const u64 cy = (u64)y->columns * y->rows;
+    return (cx < cy) - (cx > cy);
+}
+
+/**
+ * Queue the lines largest first. Idle workers steal the oldest tasks, so
+ * they pick up the largest mazes, while this thread works back from the
+ * smallest as it waits.
+ */
+static int batch_spawn(struct batch *b, struct pool_group *group,
+                       struct batch_task *tasks) {
+    struct batch_line **order = malloc(sizeof(*order) * (b->nlines + 1));
+    if (order == NULL) {
+        fprintf(stderr, "Unable to allocate memory for jobs\n");
+        return -1;
+    }
+    for (u64 l = 0; l < b->nlines; ++l) {
+        order[l] = &b->lines[l];
+    }
+    qsort(order, b->nlines, sizeof(*order), batch_line_larger);
+
+    for (u64 l = 0; l < b->nlines; ++l) {
+        tasks[l] = (struct batch_task) { .b = b, .line = order[l] };
+        pool_spawn(group, batch_line, &tasks[l]);
+    }
+    free(order);
+    return 0;
+}
+
+static void batch_free(struct batch *b) {
+    free(b->lines);
+    free(b->hashes);
+    free(b->written);
+}
+
+int batch_run(const struct maze_job *job, const struct batch_opts *opts) {
+    struct batch b = {
+        .job = *job,
+        .opts = opts,
+    };
+    atomic_init(&b.failed, 0);
+    b.job.max_mem = job->max_mem / pool_threads();
+
+    if (opts->jobs) {
+        if (batch_load(opts->jobs, &b.lines, &b.nlines) != 0) {
+            return -1;
+        }
+    } else {
+        b.lines = malloc(sizeof(struct batch_line));
+        if (b.lines == NULL) {
+            fprintf(stderr, "Unable to allocate memory for jobs\n");
+            return -1;
+        }
+        b.lines[0] = (struct batch_line) {
+            .columns = job->columns,
+            .rows = job->rows,
+            .seed = job->seed,
+            .count = opts->count,
+        };
+        b.nlines = 1;
+    }
+    batch_slice(&b);
+
+    if (opts->shards) {
+        b.hashes = malloc(sizeof(u64) * (b.count ? b.count : 1));
+        b.written = calloc(b.count ? b.count : 1, 1);
+        if (b.hashes == NULL || b.written == NULL) {
+            fprintf(stderr, "Unable to allocate memory for manifest\n");
+            batch_free(&b);
+            return -1;
+        }
+    }
+
+    struct batch_task *tasks = malloc(sizeof(struct batch_task) *
+                                      (b.nlines + 1));
+    if (tasks == NULL) {
+        fprintf(stderr, "Unable to allocate memory for jobs\n");
+        batch_free(&b);
+        return -1;
+    }
+
+    struct sigaction sa = { .sa_handler = batch_on_sigusr1 };
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sa, NULL);
+
+    stats_start();
+    struct pool_group group = {0};
+    int err = batch_spawn(&b, &group, tasks);
+    pool_wait(&group);
+    free(tasks);
+
+    stats_report(stdout);
+
+    if (atomic_load(&b.failed)) {
+        err = -1;
+    }
+    if (b.hashes && batch_manifest(&b) != 0) {
+        err = -1;
+    }
+    batch_free(&b);
+    return err;
+}
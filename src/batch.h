@@ -0,0 +1,48 @@
+/**
+ * @brief Batch runs
+ *
+ * Generate many mazes with consecutive seeds across worker threads, writing
+ * each to its own file and reporting latency metrics as JSON.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "types.h"
+#include "job.h"
+
+struct batch_opts {
+    /** Number of mazes to generate. */
+    u64 count;
+    /** Directory the mazes are written to. */
+    const char *dir;
+    /** Job file listing the mazes to run instead of `count`, or NULL. */
+    const char *jobs;
+
+    /** Run only slice `shard` of `shards` of the batch, if `shards` > 0. */
+    u64 shard;
+    u64 shards;
+};
+
+/**
+ * Run `opts.count` copies of `job`, the k'th using seed `job.seed + k`, and
+ * write each to `<dir>/<seed>.<ext>`. With `opts.jobs`, run the sizes and
+ * seeds listed in that file instead, writing `<dir>/<w>x<h>-<seed>.<ext>`.
+ * The memory budget of `job` is shared between the threads of the pool.
+ *
+ * Mazes are run on the pool, largest first. Mazes of a million cells or
+ * more are drawn in bands spread over all threads.
+ *
+ * With `opts.shards` set, only the `opts.shard`'th of that many contiguous,
+ * balanced slices of the mazes is generated, and a manifest of each maze's
+ * seed, file and 64 bit FNV-1a hash is written to
+ * `<dir>/manifest-<shard>-of-<shards>.tsv` in job order. Shards share no
+ * mazes, so their manifests concatenate in shard order.
+ *
+ * Metrics are written to standard output as JSON when the batch finishes,
+ * and whenever the process receives SIGUSR1.
+ *
+ * @return 0 on success, -1 if any maze failed.
+ */
+int batch_run(const struct maze_job *job, const struct batch_opts *opts);
+
+#endif /* BATCH_H */
@@ -0,0 +1,74 @@
+/** @brief Braille terminal output implementation */
+#include "braille.h"
+
+/* Grid cells covered by one character. */
+#define BRAILLE_COLUMNS 2
+#define BRAILLE_ROWS 4
+
+/*
+ * UTF-8 of U+2800 + m for every dot mask m: E2, A0 + m / 64, 80 + m % 64.
+ */
+#define BRAILLE_1(m) {0xE2, 0xA0 | ((m) >> 6), 0x80 | ((m) & 0x3F)}
+#define BRAILLE_4(m) BRAILLE_1(m), BRAILLE_1((m) + 1), \
+                     BRAILLE_1((m) + 2), BRAILLE_1((m) + 3)
+#define BRAILLE_16(m) BRAILLE_4(m), BRAILLE_4((m) + 4), \
+                      BRAILLE_4((m) + 8), BRAILLE_4((m) + 12)
+#define BRAILLE_64(m) BRAILLE_16(m), BRAILLE_16((m) + 16), \
+                      BRAILLE_16((m) + 32), BRAILLE_16((m) + 48)
+
+static const u8 braille_utf8[256][3] = {
+    BRAILLE_64(0), BRAILLE_64(64), BRAILLE_64(128), BRAILLE_64(192),
+};
+
+/*
+ * Dot bits by row, left and right: dots 1-3 and 4-6 run down the first
+ * three rows, dots 7 and 8 sit below them.
+ */
+static const u8 braille_dot[BRAILLE_ROWS][BRAILLE_COLUMNS] = {
+    {0x01, 0x08},
+    {0x02, 0x10},
+    {0x04, 0x20},
+    {0x40, 0x80},
+};
+
+static u32 braille_lines(const grid *maze) {
+    return (maze->rows + BRAILLE_ROWS - 1) / BRAILLE_ROWS;
+}
+
+static u64 braille_line_bytes(const grid *maze) {
+    return (u64)(maze->columns + BRAILLE_COLUMNS - 1) / BRAILLE_COLUMNS * 3 + 1;
+}
+
+u64 braille_draw_band(FILE *out, const grid *maze, u32 band, u32 bands) {
+    const u32 lines = braille_lines(maze);
+    const u32 l0 = (u32)((u64)lines * band / bands);
+    const u32 l1 = (u32)((u64)lines * (band + 1) / bands);
+
+    for (u32 l = l0; l < l1; ++l) {
+        const u32 y0 = l * BRAILLE_ROWS;
+        const u32 rows = (maze->rows - y0 < BRAILLE_ROWS) ? maze->rows - y0
+                                                       : BRAILLE_ROWS;
+        for (u32 x0 = 0; x0 < maze->columns; x0 += BRAILLE_COLUMNS) {
+            const u32 columns = (maze->columns - x0 < BRAILLE_COLUMNS)
+                ? maze->columns - x0 : BRAILLE_COLUMNS;
+            u8 mask = 0;
+            for (u32 dy = 0; dy < rows; ++dy) {
+                for (u32 dx = 0; dx < columns; ++dx) {
+                    if (grid_get(maze, x0 + dx, y0 + dy)) {
+                        mask |= braille_dot[dy][dx];
+                    }
+                }
+            }
+            fwrite(braille_utf8[mask], 1, 3, out);
+        }
+        fputc('\n', out);
+    }
+    return (u64)(l1 - l0) * braille_line_bytes(maze);
+}
+
+u64 braille_size_band(const grid *maze, u32 band, u32 bands) {
+    const u32 lines = braille_lines(maze);
+    const u32 l0 = (u32)((u64)lines * band / bands);
+    const u32 l1 = (u32)((u64)lines * (band + 1) / bands);
+    return (u64)(l1 - l0) * braille_line_bytes(maze);
+}
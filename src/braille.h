@@ -0,0 +1,27 @@
+/**
+ * @brief Braille terminal output
+ *
+ * Draw a maze grid with Unicode Braille patterns, each character showing a
+ * block of 2 x 4 grid cells as raised dots for walls. Output is an eighth
+ * of the characters of ASCII output, for previews in a terminal or logs.
+ */
+#ifndef BRAILLE_H
+#define BRAILLE_H
+
+#include <stdio.h>
+
+#include "types.h"
+#include "grid.h"
+
+/**
+ * Draw band `band` of `bands` of the lines of `maze` as Braille patterns
+ * in UTF-8. Bands split the lines evenly and can be drawn concurrently.
+ *
+ * @return Number of bytes written.
+ */
+u64 braille_draw_band(FILE *out, const grid *maze, u32 band, u32 bands);
+
+/** Number of bytes `braille_draw_band` would write, without drawing. */
+u64 braille_size_band(const grid *maze, u32 band, u32 bands);
+
+#endif /* BRAILLE_H */
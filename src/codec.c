@@ -0,0 +1,340 @@
+/** @brief Maze walk codec implementation */
+#include "codec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Binary range coder in the style of LZMA: 11 bit probabilities adapting
+ * by 1/32 per coded bit, bytes shifted out with delayed carry. */
+#define RC_TOP (1u << 24)
+#define RC_PROB_BITS 11
+#define RC_MOVE_BITS 5
+
+
+static void rc_put(struct rc_encoder *rc, u8 byte) {
+    if (rc->len == rc->cap) {
+        size_t cap = rc->cap ? rc->cap * 2 : 4096;
+        u8 *grown = realloc(rc->buf, cap);
+        if (grown == NULL) {
+            /* Reported on finish, the bytes are lost anyway. */
+            rc->failed = 1;
+            return;
+        }
+        rc->buf = grown;
+        rc->cap = cap;
+    }
+    rc->buf[rc->len++] = byte;
+}
+
+static void rc_shift_low(struct rc_encoder *rc) {
+    if ((u32)rc->low < 0xFF000000u || (rc->low >> 32) != 0) {
+        u8 carry = (u8)(rc->low >> 32);
+        u8 out = rc->cache;
+        do {
+            rc_put(rc, (u8)(out + carry));
+            out = 0xFF;
+        } while (--rc->cache_size != 0);
+        rc->cache = (u8)(rc->low >> 24);
+    }
+    ++rc->cache_size;
+    rc->low = (rc->low & 0x00FFFFFFu) << 8;
+}
+
+void rc_encoder_init(struct rc_encoder *rc) {
+    memset(rc, 0, sizeof(*rc));
+    rc->range = 0xFFFFFFFFu;
+    rc->cache_size = 1;
+}
+
+void rc_encode_bit(struct rc_encoder *rc, u16 *prob, u32 bit) {
+    u32 bound = (rc->range >> RC_PROB_BITS) * *prob;
+    if (!bit) {
+        rc->range = bound;
+        *prob += ((1u << RC_PROB_BITS) - *prob) >> RC_MOVE_BITS;
+    } else {
+        rc->low += bound;
+        rc->range -= bound;
+        *prob -= *prob >> RC_MOVE_BITS;
+    }
+    while (rc->range < RC_TOP) {
+        rc->range <<= 8;
+        rc_shift_low(rc);
+    }
+}
+
+int rc_encoder_finish(struct rc_encoder *rc) {
+    for (int k = 0; k < 5; ++k) {
+        rc_shift_low(rc);
+    }
+    return rc->failed ? -1 : 0;
+}
+
+void rc_encoder_free(struct rc_encoder *rc) {
+    free(rc->buf);
+    rc->buf = NULL;
+    rc->len = rc->cap = 0;
+}
+
+static u8 rc_get(struct rc_decoder *rc) {
+    return (rc->pos < rc->len) ? rc->buf[rc->pos++] : 0;
+}
+
+void rc_decoder_init(struct rc_decoder *rc, const u8 *buf, size_t len) {
+    rc->buf = buf;
+    rc->len = len;
+    rc->pos = 0;
+    rc->range = 0xFFFFFFFFu;
+    rc->code = 0;
+    /* The first byte out of the encoder is always the empty cache. */
+    for (int k = 0; k < 5; ++k) {
+        rc->code = (rc->code << 8) | rc_get(rc);
+    }
+}
+
+u32 rc_decode_bit(struct rc_decoder *rc, u16 *prob) {
+    u32 bound = (rc->range >> RC_PROB_BITS) * *prob;
+    u32 bit;
+    if (rc->code < bound) {
+        rc->range = bound;
+        *prob += ((1u << RC_PROB_BITS) - *prob) >> RC_MOVE_BITS;
+        bit = 0;
+    } else {
+        rc->code -= bound;
+        rc->range -= bound;
+        *prob -= *prob >> RC_MOVE_BITS;
+        bit = 1;
+    }
+    while (rc->range < RC_TOP) {
+        rc->range <<= 8;
+        rc->code = (rc->code << 8) | rc_get(rc);
+    }
+    return bit;
+}
+
+/* --- Walk model --- */
+
+/* Walk directions match the generator: east, west, south, north. Turning
+ * left or right of a heading, with y growing down the page. */
+static const int walk_dx[4] = {1, -1, 0, 0};
+static const int walk_dy[4] = {0, 0, 1, -1};
+static const u8 walk_left[4] = {3, 2, 0, 1};
+static const u8 walk_right[4] = {2, 3, 1, 0};
+/* Moves in a 4 bit option mask, without relying on a popcount insn. */
+static const u8 walk_count[16] = {0, 1, 1, 2, 1, 2, 2, 3,
+                                  1, 2, 2, 3, 2, 3, 3, 4};
+
+static inline void walk_mark(struct walk_state *ws, u32 x, u32 y) {
+    const u64 i = (u64)y * ws->columns + x;
+    ws->visited[i >> 3] |= (u8)(1u << (i & 7));
+}
+
+int walk_init(struct walk_state *ws, u32 columns, u32 rows, u32 x, u32 y) {
+    memset(ws, 0, sizeof(*ws));
+    ws->columns = columns;
+    ws->rows = rows;
+    ws->x = x;
+    ws->y = y;
+    ws->cap = 4096;
+    ws->visited = calloc(((u64)columns * rows + 7) / 8, 1);
+    ws->stack = malloc(ws->cap);
+    if (ws->visited == NULL || ws->stack == NULL) {
+        walk_free(ws);
+        return -1;
+    }
+    for (u32 k = 0; k < WALK_CONTEXTS; ++k) {
+        ws->probs[k] = RC_PROB_INIT;
+    }
+    walk_mark(ws, x, y);
+    return 0;
+}
+
+void walk_free(struct walk_state *ws) {
+    free(ws->visited);
+    free(ws->stack);
+    ws->visited = NULL;
+    ws->stack = NULL;
+}
+
+static inline int walk_bit(const u8 *bits, u64 i) {
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+u32 walk_options(const struct walk_state *ws) {
+    /* Neighbours of cell i are i + 1, i - 1, i + columns, i - columns. */
+    const u64 i = (u64)ws->y * ws->columns + ws->x;
+    u32 options = 0;
+    if (ws->x + 1 < ws->columns && !walk_bit(ws->visited, i + 1)) {
+        options |= 1;
+    }
+    if (ws->x > 0 && !walk_bit(ws->visited, i - 1)) {
+        options |= 2;
+    }
+    if (ws->y + 1 < ws->rows && !walk_bit(ws->visited, i + ws->columns)) {
+        options |= 4;
+    }
+    if (ws->y > 0 && !walk_bit(ws->visited, i - ws->columns)) {
+        options |= 8;
+    }
+    if (ws->depth > 0) {
+        options |= 1u << (ws->stack[ws->depth - 1] ^ 1);
+    }
+    return options;
+}
+
+int walk_apply(struct walk_state *ws, u32 move) {
+    ws->x += walk_dx[move];
+    ws->y += walk_dy[move];
+
+    if (ws->depth > 0 && move == (u32)(ws->stack[ws->depth - 1] ^ 1)) {
+        --ws->depth;
+        ws->prev_back = 1;
+        return 0;
+    }
+
+    if (ws->depth == ws->cap) {
+        u8 *grown = realloc(ws->stack, ws->cap * 2);
+        if (grown == NULL) {
+            return -1;
+        }
+        ws->stack = grown;
+        ws->cap *= 2;
+    }
+    ws->stack[ws->depth++] = (u8)move;
+    walk_mark(ws, ws->x, ws->y);
+    ws->prev_back = 0;
+    return 1;
+}
+
+void walk_candidates(const struct walk_state *ws, u8 order[4]) {
+    u8 h = ws->depth ? ws->stack[ws->depth - 1] : 0;
+    order[0] = h ^ 1;
+    order[1] = h;
+    order[2] = walk_left[h];
+    order[3] = walk_right[h];
+}
+
+static u16* walk_prob(struct walk_state *ws, u32 pos, u32 remaining) {
+    return &ws->probs[(pos * 3 + (remaining - 2)) * 2 + ws->prev_back];
+}
+
+int walk_encode(struct walk_state *ws, struct rc_encoder *rc, u32 move) {
+    u32 options = walk_options(ws);
+    u32 remaining = walk_count[options];
+    u8 order[4];
+    walk_candidates(ws, order);
+
+    for (u32 k = 0; k < 4 && remaining > 1; ++k) {
+        if (!(options & (1u << order[k]))) {
+            continue;
+        }
+        u32 hit = (order[k] == move);
+        rc_encode_bit(rc, walk_prob(ws, k, remaining), hit);
+        if (hit) {
+            break;
+        }
+        --remaining;
+    }
+    return walk_apply(ws, move);
+}
+
+int walk_decode_grid(struct walk_state *ws, struct rc_decoder *rc,
+                     grid *maze, u64 limit) {
+    /* Steps between neighbouring corridor cells of the grid. */
+    const i64 stride = (i64)maze->stride;
+    const i64 step[4] = {2, -2, 2 * stride, -2 * stride};
+    const u32 columns = ws->columns;
+    const u32 rows = ws->rows;
+    u32 x = ws->x;
+    u32 y = ws->y;
+    u8 *cell = grid_row(maze, y * 2 + 1) + (u64)x * 2 + 1;
+    u64 depth = ws->depth;
+    u32 prev_back = ws->prev_back;
+    int err = 0;
+    *cell = 0;
+
+    /* As walk_decode, with unvisited cells still walls in the grid. */
+    for (u64 moves = 0;; ++moves) {
+        const u32 back = depth ? (u32)ws->stack[depth - 1] ^ 1 : 4;
+        u32 options = (x + 1 < columns && cell[2]) ? 1 : 0;
+        options |= (x > 0 && cell[-2]) ? 2 : 0;
+        options |= (y + 1 < rows && cell[step[2]]) ? 4 : 0;
+        options |= (y > 0 && cell[step[3]]) ? 8 : 0;
+        options |= (1u << back) & 15;
+        if (options == 0) {
+            break;
+        }
+        if (moves == limit) {
+            err = -1;
+            break;
+        }
+
+        const u32 h = depth ? ws->stack[depth - 1] : 0;
+        const u8 order[4] = {(u8)(h ^ 1), (u8)h, walk_left[h], walk_right[h]};
+        u32 remaining = walk_count[options];
+        u32 move = 0;
+        for (u32 k = 0; k < 4; ++k) {
+            if (!(options & (1u << order[k]))) {
+                continue;
+            }
+            move = order[k];
+            if (remaining == 1 || rc_decode_bit(rc, &ws->probs[
+                    (k * 3 + (remaining - 2)) * 2 + prev_back])) {
+                break;
+            }
+            --remaining;
+        }
+
+        cell += step[move];
+        x += (u32)walk_dx[move];
+        y += (u32)walk_dy[move];
+        if (move == back) {
+            --depth;
+            prev_back = 1;
+            continue;
+        }
+
+        if (depth == ws->cap) {
+            u8 *grown = realloc(ws->stack, ws->cap * 2);
+            if (grown == NULL) {
+                err = -1;
+                break;
+            }
+            ws->stack = grown;
+            ws->cap *= 2;
+        }
+        ws->stack[depth++] = (u8)move;
+        cell[-step[move] / 2] = 0;
+        *cell = 0;
+        prev_back = 0;
+    }
+
+    ws->x = x;
+    ws->y = y;
+    ws->depth = depth;
+    ws->prev_back = (u8)prev_back;
+    return err;
+}
+
+int walk_decode(struct walk_state *ws, struct rc_decoder *rc) {
+    u32 options = walk_options(ws);
+    if (options == 0) {
+        return WALK_END;
+    }
+    u32 remaining = walk_count[options];
+    u8 order[4];
+    walk_candidates(ws, order);
+
+    u32 move = 0;
+    for (u32 k = 0; k < 4; ++k) {
+        if (!(options & (1u << order[k]))) {
+            continue;
+        }
+        move = order[k];
+        if (remaining == 1 ||
+            rc_decode_bit(rc, walk_prob(ws, k, remaining))) {
+            break;
+        }
+        --remaining;
+    }
+    return (walk_apply(ws, move) < 0) ? -1 : (int)move;
+}
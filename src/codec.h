@@ -0,0 +1,168 @@
+/**
+ * @brief Maze walk codec
+ *
+ * An adaptive binary range coder, and a model for coding depth first walks
+ * of a maze as a stream of moves between neighbouring cells.
+ *
+ * A walk is a sequence of 2 bit moves (the walk direction indices used by
+ * the generator). Moving back towards the cell we came from is a backtrack,
+ * any other move carves into a new cell. The walk ends back at its starting
+ * cell once no unvisited neighbour remains there. Both sides of the codec
+ * replay the walk, so moves into visited or out of bounds cells are never
+ * coded, and a cell with only one possible move costs nothing.
+ */
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stddef.h>
+
+#include "types.h"
+#include "grid.h"
+
+/* --- Little endian fields --- */
+
+/** Store the low `bytes` bytes of `v` at `p`, least significant first. */
+static inline void codec_put_le(u8 *p, u64 v, u32 bytes) {
+    for (u32 k = 0; k < bytes; ++k) {
+        p[k] = (u8)(v >> (8 * k));
+    }
+}
+
+/** Load the `bytes` byte little endian value at `p`. */
+static inline u64 codec_get_le(const u8 *p, u32 bytes) {
+    u64 v = 0;
+    for (u32 k = 0; k < bytes; ++k) {
+        v |= (u64)p[k] << (8 * k);
+    }
+    return v;
+}
+
+/* --- Range coder --- */
+
+struct rc_encoder {
+    u64 low;
+    u32 range;
+    u8 cache;
+    u64 cache_size;
+
+    u8 *buf;
+    size_t len;
+    size_t cap;
+    u8 failed;
+};
+
+struct rc_decoder {
+    u32 range;
+    u32 code;
+
+    const u8 *buf;
+    size_t pos;
+    size_t len;
+};
+
+/** Initial value for adaptive bit probabilities. */
+#define RC_PROB_INIT 1024
+
+/** Start encoding into a growing buffer owned by the encoder. */
+void rc_encoder_init(struct rc_encoder *rc);
+
+/** Encode `bit` with the adaptive probability `prob`. */
+void rc_encode_bit(struct rc_encoder *rc, u16 *prob, u32 bit);
+
+/**
+ * Flush the encoder. `rc->buf` holds `rc->len` coded bytes afterwards.
+ *
+ * @return 0 on success, -1 if memory ran out while encoding.
+ */
+int rc_encoder_finish(struct rc_encoder *rc);
+
+/** Free the encoder's buffer. */
+void rc_encoder_free(struct rc_encoder *rc);
+
+/** Start decoding `len` bytes from `buf`. */
+void rc_decoder_init(struct rc_decoder *rc, const u8 *buf, size_t len);
+
+/** Decode a bit with the adaptive probability `prob`. */
+u32 rc_decode_bit(struct rc_decoder *rc, u16 *prob);
+
+/* --- Walk model --- */
+
+/** Move index that ends a walk, once back at the start. */
+#define WALK_END 4
+
+/* Contexts: candidate position x remaining candidates x previous move. */
+#define WALK_CONTEXTS (3 * 3 * 2)
+
+struct walk_state {
+    u32 columns;
+    u32 rows;
+    u32 x;
+    u32 y;
+
+    /** Visited cells, one bit each. */
+    u8 *visited;
+    /** Direction taken into each cell on the path back to the start. */
+    u8 *stack;
+    u64 depth;
+    u64 cap;
+
+    u8 prev_back;
+    u16 probs[WALK_CONTEXTS];
+};
+
+/**
+ * Start a walk of a `columns` x `rows` maze at `x`, `y`.
+ *
+ * @return 0 on success, -1 if memory could not be allocated.
+ */
+int walk_init(struct walk_state *ws, u32 columns, u32 rows, u32 x, u32 y);
+
+/** Free a walk's working memory. */
+void walk_free(struct walk_state *ws);
+
+/**
+ * Bit mask of the moves possible from the current cell, bit `d` for walk
+ * direction `d`. Zero once the walk has ended.
+ */
+u32 walk_options(const struct walk_state *ws);
+
+/**
+ * Apply `move`, which must be one of `walk_options`.
+ *
+ * @return 1 if the move carved a new cell, 0 for a backtrack, -1 if memory
+ *         could not be allocated.
+ */
+int walk_apply(struct walk_state *ws, u32 move);
+
+/**
+ * Candidate moves in coding order: back, forward, left, right of the
+ * current heading (east at the start). A walk that takes the first
+ * possible candidate codes in the fewest bits.
+ */
+void walk_candidates(const struct walk_state *ws, u8 order[4]);
+
+/** Encode `move`, which must be one of `walk_options`, then apply it. */
+int walk_encode(struct walk_state *ws, struct rc_encoder *rc, u32 move);
+
+/**
+ * Decode and apply the next move.
+ *
+ * @return The move, WALK_END once the walk is over, or -1 if memory could
+ *         not be allocated.
+ */
+int walk_decode(struct walk_state *ws, struct rc_decoder *rc);
+
+/**
+ * Decode the rest of a walk, carving each cell it enters and the wall it
+ * crosses into `maze`, a byte grid of the walk's corridors with every wall
+ * in place. The grid's corridor cells stand in for the visited cells of
+ * `ws`, which are left as they were, so each move reads and writes only the
+ * grid bytes around the current cell.
+ *
+ * @return 0 once the walk ends, -1 if memory could not be allocated or the
+ *         walk ran past `limit` moves.
+ */
+int walk_decode_grid(struct walk_state *ws, struct rc_decoder *rc,
+                     grid *maze, u64 limit);
+
+#endif /* CODEC_H */
@@ -0,0 +1,143 @@
+/** @brief Filled outline SVG output implementation */
+#include "fill.h"
+
+#include "trace.h"
+#include <stdlib.h>
+
+/* Directions along cell edges: east, south, west, north. */
+enum { FILL_E, FILL_S, FILL_W, FILL_N };
+
+static const int fill_dx[4] = {1, 0, -1, 0};
+static const int fill_dy[4] = {0, 1, 0, -1};
+
+/*
+ * Cells ahead to the left and right on arriving at a corner heading each
+ * way, as offsets from the corner, whose cells are at -1 and 0 each way.
+ */
+static const int fill_left[4][2] = {{0, -1}, {0, 0}, {-1, 0}, {-1, -1}};
+static const int fill_right[4][2] = {{0, 0}, {-1, 0}, {-1, -1}, {0, -1}};
+
+struct fill {
+    FILE *out;
+    const grid *maze;
+    /* Top edges of wall cells already traced, one bit per cell. */
+    u8 *traced;
+    /* Twice the corridor width, and the wall thickness. */
+    i64 cw2;
+    i64 t;
+    i64 n;
+};
+
+static int fill_wall(const grid *maze, i64 x, i64 y) {
+    return x >= 0 && y >= 0 && x < maze->columns && y < maze->rows &&
+           grid_get(maze, (u32)x, (u32)y);
+}
+
+/**
+ * Twice the drawing coordinate of cell corner `c`. Even cells are wall
+ * posts `t` wide centred on a multiple of the corridor width, odd cells
+ * span the gap between two posts.
+ */
+static i64 fill_coord(const struct fill *f, i64 c) {
+    return (c / 2) * f->cw2 + ((c % 2) ? f->t : -f->t);
+}
+
+/* Print a doubled coordinate, halves as .5. */
+static void fill_num(struct fill *f, char cmd, i64 v) {
+    const char *sign = (v < 0) ? "-" : "";
+    const i64 a = (v < 0) ? -v : v;
+    f->n += fprintf(f->out, (a & 1) ? "%c%s%lld.5" : "%c%s%lld", cmd, sign,
+                    (long long)(a / 2));
+}
+
+static void fill_mark(struct fill *f, i64 x, i64 y) {
+    const u64 i = (u64)y * f->maze->columns + (u64)x;
+    f->traced[i >> 3] |= (u8)(1u << (i & 7));
+}
+
+static int fill_marked(const struct fill *f, u32 x, u32 y) {
+    const u64 i = (u64)y * f->maze->columns + x;
+    return (f->traced[i >> 3] >> (i & 7)) & 1;
+}
+
+/*
+ * Trace the outline starting east along the top of wall cell `x`, `y`,
+ * keeping wall on the right, until back at the start.
+ */
+static void fill_trace(struct fill *f, u32 x, u32 y) {
+    const grid *maze = f->maze;
+    i64 cx = x;
+    i64 cy = y;
+    int d = FILL_E;
+
+    fill_num(f, 'M', fill_coord(f, cx));
+    fill_num(f, ' ', fill_coord(f, cy));
+    do {
+        if (d == FILL_E) {
+            fill_mark(f, cx, cy);
+        }
+        cx += fill_dx[d];
+        cy += fill_dy[d];
+
+        int turn = d;
+        if (fill_wall(maze, cx + fill_left[d][0], cy + fill_left[d][1])) {
+            turn = (d + 3) & 3;
+        } else if (!fill_wall(maze, cx + fill_right[d][0],
+                              cy + fill_right[d][1])) {
+            turn = (d + 1) & 3;
+        }
+
+        /* A vertex at every turn, where the outline leaves the line. */
+        if (turn != d) {
+            if (d == FILL_E || d == FILL_W) {
+                fill_num(f, 'H', fill_coord(f, cx));
+            } else {
+                fill_num(f, 'V', fill_coord(f, cy));
+            }
+            d = turn;
+        }
+    } while (cx != x || cy != y || d != FILL_E);
+    f->n += fprintf(f->out, "Z");
+}
+
+i64 fill_draw_svg(FILE *out, const grid *maze, const struct svg_opts *opts) {
+    struct fill f = {
+        .out = out,
+        .maze = maze,
+        .cw2 = (i64)opts->corridor_width * 2,
+        .t = opts->pen_radius,
+    };
+    /* Walls at least as thick as the corridors close them off. */
+    if (f.t > (i64)opts->corridor_width) {
+        f.t = opts->corridor_width;
+    }
+    f.traced = calloc(((u64)maze->columns * maze->rows + 7) / 8, 1);
+    if (f.traced == NULL) {
+        fprintf(stderr, "Unable to allocate memory for wall outlines\n");
+        return -1;
+    }
+
+    const u32 total_width = (maze->columns / 2) * opts->corridor_width;
+    const u32 total_height = (maze->rows / 2) * opts->corridor_width;
+    f.n += fprintf(out, "<?xml version='1.0' standalone='no'?>\n");
+    f.n += fprintf(out, "<svg xmlns='http://www.w3.org/2000/svg' "
+                   "viewBox='0 0 %u %u'>", total_width, total_height);
+    f.n += fprintf(out, "<path fill='%s' fill-rule='evenodd' d='",
+                   opts->fg_color);
+
+    /* Every outline heads east along the top of some wall cell. */
+    TRACE_BEGIN("outline");
+    for (u32 y = 0; y < maze->rows; ++y) {
+        for (u32 x = 0; x < maze->columns; ++x) {
+            if (grid_get(maze, x, y) && !fill_wall(maze, x, (i64)y - 1) &&
+                !fill_marked(&f, x, y)) {
+                fill_trace(&f, x, y);
+            }
+        }
+    }
+    TRACE_END("outline");
+
+    f.n += fprintf(out, "'/></svg>\n");
+    free(f.traced);
+    return f.n;
+}
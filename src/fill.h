@@ -0,0 +1,29 @@
+/**
+ * @brief Filled outline SVG output
+ *
+ * Draw the walls of a maze as filled polygons rather than stroked lines.
+ * The outline of every connected group of wall cells is traced around the
+ * cell grid, and all outlines go in one path filled with the even-odd
+ * rule, so enclosed corridors are holes. The document then grows with the
+ * length of the outlines rather than the number of wall runs, and thick
+ * walls are not painted over many times.
+ */
+#ifndef FILL_H
+#define FILL_H
+
+#include <stdio.h>
+
+#include "types.h"
+#include "grid.h"
+#include "maze.h"
+
+/**
+ * Draw `maze` to `out` as an SVG document of the same size as
+ * `maze_draw_svg`, its walls `opts.pen_radius` pixels thick filled with
+ * `opts.fg_color`. Wall ends are square rather than round.
+ *
+ * @return Number of bytes written, or -1 if memory could not be allocated.
+ */
+i64 fill_draw_svg(FILE *out, const grid *maze, const struct svg_opts *opts);
+
+#endif /* FILL_H */
@@ -0,0 +1,304 @@
+/** @brief Seed search implementation */
+#include "find.h"
+
+#include "version.h"
+#include "grid.h"
+#include "maze.h"
+#include "pool.h"
+#include "prng.h"
+#include "solve.h"
+#include "trace.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Seeds a thread claims at a time, few enough to stop soon after a match. */
+#define FIND_BLOCK 16
+
+/* Walk directions, as used by the generator: east, west, south, north. */
+static const int find_dx[4] = {1, -1, 0, 0};
+static const int find_dy[4] = {0, 0, 1, -1};
+
+/* Frames of the solution walk hold the direction a cell was entered by in
+ * the low bits, or FRAME_ROOT at the start, and the next direction to try
+ * above them. */
+#define FRAME_ROOT 4
+#define FRAME_NEXT(f) ((u32)(f) >> 4)
+
+struct find_match {
+    u64 index;
+    u64 path;
+    u64 dead;
+};
+
+struct find {
+    const struct find_opts *opts;
+    u64 seed;
+    u32 columns;
+    u32 rows;
+    struct solve_ends ends;
+    /* Limits of the search, in cells. */
+    u64 min_path;
+    u64 max_dead;
+
+    /* Next seed index to claim. Indexes at or past `limit` are not tried,
+     * it drops to the last of the matches once there are enough. */
+    atomic_ullong next;
+    atomic_ullong limit;
+    atomic_uint failed;
+
+    /* First matches in seed order, `opts->count` at most. */
+    pthread_mutex_t lock;
+    struct find_match *matches;
+    u64 found;
+};
+
+/* Working memory and counts of one thread. */
+struct find_worker {
+    struct find *f;
+    grid *maze;
+    u8 *stack;
+
+    u64 tried;
+    u64 dead_ends;
+    u64 short_paths;
+};
+
+
+/* Count the dead ends of `maze`, stopping after the row that takes the
+ * count past `most`. */
+static u64 find_dead_ends(const grid *maze, u64 most) {
+    u64 dead = 0;
+    for (u32 y = 1; y < maze->rows; y += 2) {
+        const u8 *up = grid_row(maze, y - 1);
+        const u8 *row = grid_row(maze, y);
+        const u8 *down = grid_row(maze, y + 1);
+        for (u32 x = 1; x < maze->columns; x += 2) {
+            dead += (row[x - 1] + row[x + 1] + up[x] + down[x] == 3);
+        }
+        if (dead > most) {
+            break;
+        }
+    }
+    return dead;
+}
+
+/**
+ * Length in cells of the path between the ends, walking depth first from
+ * one end with a frame per step on `stack`. A cell backed out of is off the
+ * path, so the walk gives up, returning 0, once fewer than `least` cells
+ * are left that the path could pass through.
+ */
+static u64 find_path(const grid *maze, const struct solve_ends *ends,
+                     u8 *stack, u64 least) {
+    const u64 cells = (u64)(maze->columns / 2) * (maze->rows / 2);
+    u32 x = ends->from_x;
+    u32 y = ends->from_y;
+    u64 depth = 0;
+    u64 off = 0;
+
+    stack[0] = FRAME_ROOT;
+    while (x != ends->to_x || y != ends->to_y) {
+        u8 *frame = &stack[depth];
+        const u32 back = (*frame & FRAME_ROOT) ? 4 : ((*frame & 3u) ^ 1);
+        u32 d = FRAME_NEXT(*frame);
+        while (d < 4 && (d == back ||
+                         grid_get(maze, x * 2 + 1 + find_dx[d],
+                                  y * 2 + 1 + find_dy[d]))) {
+            ++d;
+        }
+
+        if (d < 4) {
+            *frame = (u8)(((d + 1) << 4) | (*frame & 7u));
+            x += find_dx[d];
+            y += find_dy[d];
+            stack[++depth] = (u8)d;
+            continue;
+        }
+
+        /* Every way on from here is explored. */
+        if (depth == 0 || cells - ++off < least) {
+            return 0;
+        }
+        x -= find_dx[*frame & 3u];
+        y -= find_dy[*frame & 3u];
+        --depth;
+    }
+    return depth + 1;
+}
+
+/* Keep the match of seed index `index` if it is among the first found. */
+static void find_add(struct find *f, u64 index, u64 path, u64 dead) {
+    const u64 count = f->opts->count;
+    pthread_mutex_lock(&f->lock);
+    if (f->found < count || index < f->matches[count - 1].index) {
+        u64 k = (f->found < count) ? f->found++ : count - 1;
+        for (; k > 0 && f->matches[k - 1].index > index; --k) {
+            f->matches[k] = f->matches[k - 1];
+        }
+        f->matches[k] = (struct find_match){index, path, dead};
+        if (f->found == count) {
+            atomic_store(&f->limit, f->matches[count - 1].index);
+        }
+    }
+    pthread_mutex_unlock(&f->lock);
+}
+
+/* Generate the maze of seed index `index` and test it. */
+static int find_try(struct find_worker *w, u64 index) {
+    struct find *f = w->f;
+    grid *maze = w->maze;
+
+    /* As maze_generate_kind would, into a grid reset to walls. */
+    prng_srand(f->seed + index);
+    memset(maze->cells, 1, maze->stride * maze->rows);
+    if (maze_carve(maze, 0, 0, f->columns, f->rows) != 0) {
+        return -1;
+    }
+    ++w->tried;
+
+    const u64 dead = find_dead_ends(maze, f->max_dead);
+    if (dead > f->max_dead) {
+        ++w->dead_ends;
+        return 0;
+    }
+    const u64 path = find_path(maze, &f->ends, w->stack, f->min_path);
+    if (path == 0 || path < f->min_path) {
+        ++w->short_paths;
+        return 0;
+    }
+    find_add(f, index, path, dead);
+    return 0;
+}
+
+/* Claim and try blocks of seeds until there are enough matches. */
+static void find_worker_run(void *arg) {
+    struct find_worker *w = arg;
+    struct find *f = w->f;
+    const u64 cells = (u64)f->columns * f->rows;
+
+    w->maze = grid_alloc_kind(f->columns * 2 + 1, f->rows * 2 + 1, 1,
+                              GRID_BYTES);
+    w->stack = malloc(cells);
+    if (w->maze == NULL || w->stack == NULL) {
+        fprintf(stderr, "Unable to allocate memory for seed search\n");
+        atomic_fetch_add(&f->failed, 1);
+        atomic_store(&f->limit, 0);
+        return;
+    }
+
+    for (;;) {
+        u64 k = atomic_fetch_add(&f->next, FIND_BLOCK);
+        for (const u64 end = k + FIND_BLOCK; k < end; ++k) {
+            if (k >= atomic_load_explicit(&f->limit, memory_order_relaxed)) {
+                return;
+            }
+            if (find_try(w, k) != 0) {
+                atomic_fetch_add(&f->failed, 1);
+                atomic_store(&f->limit, 0);
+                return;
+            }
+        }
+    }
+}
+
+/* The number of cells that is `percent` of `cells`, rounded up if `up`. */
+static u64 find_cells(double percent, u64 cells, int up) {
+    const double want = percent * (double)cells / 100.0;
+    if (want <= 0.0 || want >= (double)cells) {
+        return (want <= 0.0) ? 0 : cells;
+    }
+    const u64 n = (u64)want;
+    return (up && (double)n < want) ? n + 1 : n;
+}
+
+int find_run(const struct maze_job *job, const struct find_opts *opts,
+             FILE *out) {
+    if ((job->topology && 0 == strcmp("tri", job->topology)) ||
+        job->nest_columns > 0) {
+        fprintf(stderr, "Unable to search seeds of triangular or nested "
+                "mazes\n");
+        return -1;
+    }
+
+    const struct solve_ends corners = {0, 0, SOLVE_LAST, SOLVE_LAST};
+    struct find f = {
+        .opts = opts,
+        .seed = job->seed,
+        .columns = job->columns,
+        .rows = job->rows,
+        .ends = solve_ends_at(job->solve ? job->solve : &corners,
+                              job->columns, job->rows),
+    };
+    if (f.ends.from_x >= f.columns || f.ends.to_x >= f.columns ||
+        f.ends.from_y >= f.rows || f.ends.to_y >= f.rows) {
+        fprintf(stderr, "Unable to solve between cells outside the maze\n");
+        return -1;
+    }
+
+    const u64 cells = (u64)f.columns * f.rows;
+    f.min_path = find_cells(opts->min_path, cells, 1);
+    f.max_dead = find_cells(opts->max_dead, cells, 0);
+
+    const u32 threads = pool_threads();
+    struct find_worker *workers = calloc(threads, sizeof(*workers));
+    f.matches = malloc(opts->count * sizeof(*f.matches));
+    if (workers == NULL || f.matches == NULL) {
+        fprintf(stderr, "Unable to allocate memory for seed search\n");
+        free(workers);
+        free(f.matches);
+        return -1;
+    }
+    pthread_mutex_init(&f.lock, NULL);
+    atomic_init(&f.next, 0);
+    atomic_init(&f.limit, opts->tries ? opts->tries : UINT64_MAX);
+    atomic_init(&f.failed, 0);
+
+    TRACE_BEGIN("find");
+    struct pool_group group = {0};
+    for (u32 t = 0; t < threads; ++t) {
+        workers[t].f = &f;
+        pool_spawn(&group, find_worker_run, &workers[t]);
+    }
+    pool_wait(&group);
+    TRACE_END("find");
+
+    u64 tried = 0, dead_ends = 0, short_paths = 0;
+    for (u32 t = 0; t < threads; ++t) {
+        tried += workers[t].tried;
+        dead_ends += workers[t].dead_ends;
+        short_paths += workers[t].short_paths;
+        grid_free(workers[t].maze);
+        free(workers[t].stack);
+    }
+    free(workers);
+    pthread_mutex_destroy(&f.lock);
+
+    if (job->verbose) {
+        fprintf(stderr, "%s: tried %llu seeds, %llu with too many dead "
+                "ends, %llu with too short a path\n", APPMETA_NAME,
+                (unsigned long long)tried, (unsigned long long)dead_ends,
+                (unsigned long long)short_paths);
+    }
+
+    for (u64 k = 0; k < f.found; ++k) {
+        const struct find_match *m = &f.matches[k];
+        fprintf(out, "%llu\t%llu\t%.2f\t%llu\t%.2f\n",
+                (unsigned long long)(f.seed + m->index),
+                (unsigned long long)m->path, 100.0 * m->path / cells,
+                (unsigned long long)m->dead, 100.0 * m->dead / cells);
+    }
+    free(f.matches);
+
+    if (atomic_load(&f.failed)) {
+        return -1;
+    }
+    if (f.found < opts->count) {
+        fprintf(stderr, "Unable to find %llu matching seeds, found %llu\n",
+                (unsigned long long)opts->count,
+                (unsigned long long)f.found);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+/**
+ * @brief Seed search
+ *
+ * Try consecutive seeds across worker threads until enough of them give
+ * mazes meeting limits on their solution length and dead ends.
+ */
+#ifndef FIND_H
+#define FIND_H
+
+#include <stdio.h>
+
+#include "types.h"
+#include "job.h"
+
+struct find_opts {
+    /** Number of matching seeds to find. */
+    u64 count;
+    /** Seeds to try from the job's seed, 0 for no limit. */
+    u64 tries;
+
+    /** Least length of the solution, in percent of cells. */
+    double min_path;
+    /** Most dead ends, in percent of cells. */
+    double max_dead;
+};
+
+/**
+ * Find the first `opts.count` seeds from `job.seed` on whose mazes the
+ * solution between the ends of `job.solve` (corner to corner if NULL) is at
+ * least `opts.min_path` percent of the cells long, and at most
+ * `opts.max_dead` percent of the cells are dead ends. Each match is written
+ * to `out` as a line of seed, path length and dead ends, in cells and in
+ * percent, tab separated and in seed order.
+ *
+ * Seeds are tried in parallel on the pool, each thread reusing one grid to
+ * generate its candidates into. Dead ends are counted first, in one pass
+ * over the grid that stops once there are too many, then the solution is
+ * walked depth first from one end, stopping once the cells left unexplored
+ * are too few to make the path long enough. Seeds past the last of the
+ * first `opts.count` matches found so far are not tried, so the matches
+ * are the same whatever the number of threads.
+ *
+ * @return 0 if `opts.count` seeds were found, -1 otherwise.
+ */
+int find_run(const struct maze_job *job, const struct find_opts *opts,
+             FILE *out);
+
+#endif /* FIND_H */
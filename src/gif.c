@@ -0,0 +1,285 @@
+/** @brief Animated GIF output implementation */
+#include "gif.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Palette indices of the canvas. */
+enum {
+    GIF_WALL,
+    GIF_DONE,
+    GIF_PATH,
+    GIF_HEAD,
+};
+
+static const u8 gif_palette[4 * 3] = {
+    0x00, 0x00, 0x00,
+    0xFF, 0xFF, 0xFF,
+    0x99, 0xCC, 0xFF,
+    0xFF, 0x33, 0x33,
+};
+
+/* Hundredths of a second per frame, and for the final frame. */
+#define GIF_DELAY 4
+#define GIF_HOLD 300
+
+/* LZW over 2 bit pixels: codes 0-3 are pixels, then clear and end. */
+#define LZW_MIN_BITS 2
+#define LZW_CLEAR 4
+#define LZW_END 5
+#define LZW_MAX_CODES 4096
+#define LZW_HASH_SIZE 8192
+
+static const int step_dx[4] = {1, -1, 0, 0};
+static const int step_dy[4] = {0, 0, 1, -1};
+
+/** Output with byte counting and GIF data sub-blocks. */
+struct gif_out {
+    FILE *out;
+    i64 bytes;
+
+    /* Pending sub-block and bit buffer of the LZW code stream. */
+    u8 block[255];
+    u32 block_len;
+    u32 bits;
+    u32 nbits;
+};
+
+/** Canvas of palette indices, one per maze grid cell. */
+struct gif_canvas {
+    u32 width;
+    u32 height;
+    u8 *cells;
+
+    /* Changed rectangle since the last frame, in grid cells. */
+    u32 x0, y0, x1, y1;
+};
+
+struct lzw {
+    u32 keys[LZW_HASH_SIZE];
+    u16 codes[LZW_HASH_SIZE];
+    u32 next;
+    u32 code_bits;
+};
+
+static void gif_write(struct gif_out *g, const void *p, size_t len) {
+    fwrite(p, 1, len, g->out);
+    g->bytes += (i64)len;
+}
+
+static void gif_u16(struct gif_out *g, u32 v) {
+    u8 b[2] = {(u8)v, (u8)(v >> 8)};
+    gif_write(g, b, 2);
+}
+
+static void gif_flush_block(struct gif_out *g) {
+    if (g->block_len > 0) {
+        u8 len = (u8)g->block_len;
+        gif_write(g, &len, 1);
+        gif_write(g, g->block, g->block_len);
+        g->block_len = 0;
+    }
+}
+
+static void gif_put_code(struct gif_out *g, u32 code, u32 bits) {
+    g->bits |= code << g->nbits;
+    g->nbits += bits;
+    while (g->nbits >= 8) {
+        g->block[g->block_len++] = (u8)g->bits;
+        g->bits >>= 8;
+        g->nbits -= 8;
+        if (g->block_len == sizeof(g->block)) {
+            gif_flush_block(g);
+        }
+    }
+}
+
+static void lzw_reset(struct lzw *z) {
+    memset(z->keys, 0xFF, sizeof(z->keys));
+    z->next = LZW_END + 1;
+    z->code_bits = LZW_MIN_BITS + 1;
+}
+
+/**
+ * Look up `key`, a prefix code followed by a pixel. Returns its slot in the
+ * hash table, which holds UINT32_MAX in `keys` if the string is new.
+ */
+static u32 lzw_find(const struct lzw *z, u32 key) {
+    u32 h = (key * 2654435761u) >> (32 - 13);
+    while (z->keys[h] != UINT32_MAX && z->keys[h] != key) {
+        h = (h + 1) & (LZW_HASH_SIZE - 1);
+    }
+    return h;
+}
+
+/* Canvas pixel (in image pixels) of a frame rectangle. */
+static inline u8 gif_pixel(const struct gif_canvas *c, u32 scale,
+                           u32 px, u32 py) {
+    return c->cells[(u64)(py / scale) * c->width + px / scale];
+}
+
+/** Encode the changed rectangle of the canvas as one frame. */
+static void gif_frame(struct gif_out *g, struct gif_canvas *c, u32 scale,
+                      struct lzw *z, u32 delay) {
+    const u32 left = c->x0 * scale;
+    const u32 top = c->y0 * scale;
+    const u32 w = (c->x1 - c->x0 + 1) * scale;
+    const u32 h = (c->y1 - c->y0 + 1) * scale;
+
+    /* Graphic control: keep the previous frame under this one. */
+    u8 gce[4] = {0x21, 0xF9, 4, 1 << 2};
+    gif_write(g, gce, 4);
+    gif_u16(g, delay);
+    u8 gce_end[2] = {0, 0};
+    gif_write(g, gce_end, 2);
+
+    u8 sep = 0x2C;
+    gif_write(g, &sep, 1);
+    gif_u16(g, left);
+    gif_u16(g, top);
+    gif_u16(g, w);
+    gif_u16(g, h);
+    u8 flags[2] = {0, LZW_MIN_BITS};
+    gif_write(g, flags, 2);
+
+    lzw_reset(z);
+    gif_put_code(g, LZW_CLEAR, z->code_bits);
+
+    u32 prefix = gif_pixel(c, scale, left, top);
+    for (u32 y = 0; y < h; ++y) {
+        for (u32 x = (y == 0) ? 1 : 0; x < w; ++x) {
+            u32 pixel = gif_pixel(c, scale, left + x, top + y);
+            u32 key = (prefix << 2) | pixel;
+            u32 slot = lzw_find(z, key);
+            if (z->keys[slot] == key) {
+                prefix = z->codes[slot];
+                continue;
+            }
+
+            gif_put_code(g, prefix, z->code_bits);
+            const u32 code = z->next++;
+            z->keys[slot] = key;
+            z->codes[slot] = (u16)code;
+            if (code >= (1u << z->code_bits)) {
+                ++z->code_bits;
+            }
+            if (code == LZW_MAX_CODES - 1) {
+                gif_put_code(g, LZW_CLEAR, z->code_bits);
+                lzw_reset(z);
+            }
+            prefix = pixel;
+        }
+    }
+    /* Clear before ending, so the end code has the starting code size. */
+    gif_put_code(g, prefix, z->code_bits);
+    gif_put_code(g, LZW_CLEAR, z->code_bits);
+    gif_put_code(g, LZW_END, LZW_MIN_BITS + 1);
+    if (g->nbits > 0) {
+        gif_put_code(g, 0, 8 - g->nbits);
+    }
+    gif_flush_block(g);
+    u8 end = 0;
+    gif_write(g, &end, 1);
+
+    c->x0 = c->y0 = UINT32_MAX;
+    c->x1 = c->y1 = 0;
+}
+
+static inline void gif_paint(struct gif_canvas *c, u32 x, u32 y, u8 colour) {
+    c->cells[(u64)y * c->width + x] = colour;
+    c->x0 = (x < c->x0) ? x : c->x0;
+    c->y0 = (y < c->y0) ? y : c->y0;
+    c->x1 = (x > c->x1) ? x : c->x1;
+    c->y1 = (y > c->y1) ? y : c->y1;
+}
+
+i64 gif_draw_walk(FILE *out, const struct maze_record *rec,
+                  u32 columns, u32 rows, u32 scale, u32 frames) {
+    scale = scale ? scale : 1;
+    frames = frames ? frames : 1;
+
+    struct gif_canvas c = {
+        .width = columns * 2 + 1,
+        .height = rows * 2 + 1,
+    };
+    if ((u64)c.width * scale > 0xFFFF || (u64)c.height * scale > 0xFFFF) {
+        fprintf(stderr, "Maze too large for GIF output at scale %u\n", scale);
+        return -1;
+    }
+
+    /* Walk direction into each cell on the path back to the start. */
+    u8 *path = malloc((u64)columns * rows + 1);
+    struct lzw *z = malloc(sizeof(struct lzw));
+    c.cells = calloc((u64)c.width * c.height, 1);
+    if (path == NULL || z == NULL || c.cells == NULL) {
+        fprintf(stderr, "Unable to allocate memory for GIF output\n");
+        free(path);
+        free(z);
+        free(c.cells);
+        return -1;
+    }
+
+    struct gif_out g = { .out = out };
+    gif_write(&g, "GIF89a", 6);
+    gif_u16(&g, c.width * scale);
+    gif_u16(&g, c.height * scale);
+    /* Global colour table of 4 entries, background 0. */
+    u8 screen[3] = {0x80 | (1 << 4) | 1, 0, 0};
+    gif_write(&g, screen, 3);
+    gif_write(&g, gif_palette, sizeof(gif_palette));
+    /* Loop forever. */
+    static const u8 loop[19] = {
+        0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+        3, 1, 0, 0, 0
+    };
+    gif_write(&g, loop, sizeof(loop));
+
+    /* The first frame is the whole canvas, walls and the walker. */
+    u32 x = rec->start_x;
+    u32 y = rec->start_y;
+    u64 depth = 0;
+    c.x0 = c.y0 = 0;
+    c.x1 = c.width - 1;
+    c.y1 = c.height - 1;
+    gif_paint(&c, x * 2 + 1, y * 2 + 1, GIF_HEAD);
+
+    u64 k = 0;
+    for (u32 f = 0; f < frames; ++f) {
+        const u64 end = rec->moves * (f + 1) / frames;
+        for (; k < end; ++k) {
+            const u32 dir = maze_record_step(rec, k);
+            const u32 gx = x * 2 + 1;
+            const u32 gy = y * 2 + 1;
+            x += step_dx[dir];
+            y += step_dy[dir];
+
+            if (depth > 0 && dir == (u32)(path[depth - 1] ^ 1)) {
+                /* Backtrack: the cell and its way in are finished. */
+                --depth;
+                gif_paint(&c, gx, gy, GIF_DONE);
+                gif_paint(&c, gx + step_dx[dir], gy + step_dy[dir], GIF_DONE);
+            } else {
+                path[depth++] = (u8)dir;
+                gif_paint(&c, gx, gy, GIF_PATH);
+                gif_paint(&c, gx + step_dx[dir], gy + step_dy[dir], GIF_PATH);
+            }
+            gif_paint(&c, x * 2 + 1, y * 2 + 1, GIF_HEAD);
+        }
+
+        if (k == rec->moves) {
+            gif_paint(&c, x * 2 + 1, y * 2 + 1, GIF_DONE);
+        }
+        if (c.x0 <= c.x1) {
+            gif_frame(&g, &c, scale, z, (f + 1 == frames) ? GIF_HOLD
+                                                          : GIF_DELAY);
+        }
+    }
+
+    u8 trailer = 0x3B;
+    gif_write(&g, &trailer, 1);
+
+    free(path);
+    free(z);
+    free(c.cells);
+    return g.bytes;
+}
@@ -0,0 +1,28 @@
+/**
+ * @brief Animated GIF output
+ *
+ * Draw the walk that carved a maze as an animated GIF, with a built in LZW
+ * encoder. Each frame only encodes the rectangle that changed since the
+ * previous one.
+ */
+#ifndef GIF_H
+#define GIF_H
+
+#include <stdio.h>
+
+#include "types.h"
+#include "maze.h"
+
+/**
+ * Draw the walk in `rec` of a `columns` x `rows` maze to `out` as an
+ * animated GIF, sampled to at most `frames` frames at 25 frames per second.
+ * Every cell of the maze grid is drawn as `scale` x `scale` pixels: walls
+ * are black, cells on the walker's path blue, the walker red and finished
+ * cells white.
+ *
+ * @return Number of bytes written, or -1 on failure.
+ */
+i64 gif_draw_walk(FILE *out, const struct maze_record *rec,
+                  u32 columns, u32 rows, u32 scale, u32 frames);
+
+#endif /* GIF_H */
@@ -4,34 +4,225 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
+#include "pool.h"
+#include "prng.h"
+#include "tmpfile.h"
+#include "trace.h"
+
+/* Grids of this many bytes or more are initialised by all pool threads. */
+#define GRID_PARALLEL_BYTES (16u << 20)
+
+
+/**
+ * Map `size` bytes of an unlinked temporary file (in $TMPDIR, or /tmp).
+ * The file disappears once the mapping is released.
+ */
+static u8* grid_map_file(const u64 size) {
+    int fd = tmp_fd("backing file");
+    if (fd < 0) {
+        return NULL;
+    }
+
+    u8 *cells = NULL;
+    if (ftruncate(fd, (off_t)size) == 0) {
+        void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            cells = p;
+        }
+    }
+    close(fd);
+
+    if (cells == NULL) {
+        fprintf(stderr, "Unable to map %llu bytes of grid cells\n",
+                (unsigned long long)size);
+    }
+    return cells;
+}
+
+u64 grid_stride(const u32 columns, const enum grid_kind kind) {
+    /* Leave a spare cell for column -1 of the next row of guarded grids. */
+    const u64 cells = (u64)columns + 1;
+    const u64 bytes = (kind == GRID_BITS) ? (cells + 7) / 8 : cells;
+    if (bytes >= GRID_ALIGN) {
+        return (bytes + GRID_ALIGN - 1) & ~(u64)(GRID_ALIGN - 1);
+    }
+
+    u64 stride = 8;
+    while (stride < bytes) {
+        stride *= 2;
+    }
+    return stride;
+}
+
+u64 grid_cell_bytes(const u32 columns, const u32 rows,
+                    const enum grid_kind kind) {
+    return grid_stride(columns, kind) * rows;
+}
+
+const char* grid_kind_name(const enum grid_kind kind) {
+    switch (kind) {
+    case GRID_BITS:
+        return "bits";
+    case GRID_MMAP:
+        return "mmap";
+    default:
+        return "bytes";
+    }
+}
+
+struct grid_fill {
+    grid *g;
+    u8 *base;
+    u64 rows;
+    u8 value;
+    u8 guard;
+    u64 bands;
+};
+
+/* Set the cell `x` cells into the row at `row`, which may be a guard row. */
+static void grid_poke(const grid *g, u8 *row, const u64 x, const u8 v) {
+    if (g->kind == GRID_BITS) {
+        const u8 bit = (u8)(1u << (x & 7));
+        row[x >> 3] = v ? (row[x >> 3] | bit) : (row[x >> 3] & (u8)~bit);
+        return;
+    }
+    row[x] = v;
+}
+
+/*
+ * Initialise bands of whole rows, as the renderers split their work. Rows
+ * count from the guard row of guarded grids, and each row writes only its
+ * own guard cells: column `columns`, and its last cell which is column -1
+ * of the row below.
+ */
+static void grid_fill_bands(u64 begin, u64 end, void *arg) {
+    const struct grid_fill *f = arg;
+    const grid *g = f->g;
+    const u64 last_cell = g->stride * ((g->kind == GRID_BITS) ? 8 : 1) - 1;
+
+    for (u64 band = begin; band < end; ++band) {
+        const u64 first = f->rows * band / f->bands;
+        const u64 last = f->rows * (band + 1) / f->bands;
+
+        TRACE_BEGIN_ARG("grid init", band);
+        memset(f->base + first * g->stride, f->value,
+               (last - first) * g->stride);
+
+        for (u64 r = first; g->guard && r < last; ++r) {
+            u8 *row = f->base + r * g->stride;
+            if (r == 0 || r == f->rows - 1) {
+                memset(row, f->guard, g->stride);
+                continue;
+            }
+            grid_poke(g, row, g->columns, f->guard);
+            grid_poke(g, row, last_cell, f->guard);
+        }
+        TRACE_END("grid init");
+    }
+}
+
+/**
+ * Set every byte of the grid's storage to `value`, and its guard ring to
+ * `guard`. Large grids are written by all pool threads, so each page is
+ * first touched, and placed in memory, near a thread that later works on
+ * those rows.
+ */
+static void grid_fill(grid *g, u8 *base, const u8 value, const u8 guard) {
+    struct grid_fill f = {
+        .g = g,
+        .base = base,
+        .rows = (u64)g->rows + 2u * g->guard,
+        .value = value,
+        .guard = guard,
+        .bands = 1,
+    };
+
+    const u32 threads = pool_threads();
+    if (g->stride * f.rows >= GRID_PARALLEL_BYTES && threads > 1 &&
+        f.rows >= threads) {
+        f.bands = threads;
+    }
+
+    /* Waiting on the bands may run other mazes of a batch here, which
+     * reseed this thread's PRNG while the maze being allocated still has
+     * its walk to draw. */
+    struct prng_state saved;
+    prng_save(&saved);
+    pool_for(0, f.bands, 1, grid_fill_bands, &f);
+    prng_restore(&saved);
+}
 
 grid* grid_alloc_init(const u32 columns, const u32 rows,
                       const u8 initval) {
+    return grid_alloc_kind(columns, rows, initval, GRID_BYTES);
+}
+
+/* Storage from the start of the allocation, guard rows included. */
+static u64 grid_size(const grid *g) {
+    return g->stride * ((u64)g->rows + 2u * g->guard);
+}
+
+static grid* grid_alloc(const u32 columns, const u32 rows,
+                        const u8 initval, const enum grid_kind kind,
+                        const u8 guarded, const u8 guard) {
     grid *g = malloc(sizeof(grid));
     if (g == NULL) {
         fprintf(stderr, "Unable to allocate memory for grid struct\n");
         return NULL;
     }
 
-    g->cells = malloc(sizeof(u8) * columns * rows);
-    if (g->cells == NULL) {
+    g->columns = columns;
+    g->rows = rows;
+    g->stride = grid_stride(columns, kind);
+    g->guard = guarded;
+    g->kind = kind;
+
+    /* Strides are multiples of 8, so the size suits aligned_alloc. */
+    const u64 size = (grid_size(g) + GRID_ALIGN - 1) &
+                     ~(u64)(GRID_ALIGN - 1);
+    u8 *base = (kind == GRID_MMAP) ? grid_map_file(size)
+                                   : aligned_alloc(GRID_ALIGN, size);
+    if (base == NULL) {
         fprintf(stderr, "Unable to allocate memory for %ux%u grid cells\n",
                 columns, rows);
         free(g);
         return NULL;
     }
+    g->cells = base + (guarded ? g->stride : 0);
 
-    g->columns = columns;
-    g->rows = rows;
-    memset(g->cells, initval, rows * columns);
+    if (kind == GRID_BITS) {
+        grid_fill(g, base, (initval & 1) ? 0xFF : 0x00,
+                  (guard & 1) ? 0xFF : 0x00);
+    } else {
+        grid_fill(g, base, initval, guard);
+    }
 
     return g;
 }
 
+grid* grid_alloc_kind(const u32 columns, const u32 rows,
+                      const u8 initval, const enum grid_kind kind) {
+    return grid_alloc(columns, rows, initval, kind, 0, 0);
+}
+
+grid* grid_alloc_guarded(const u32 columns, const u32 rows,
+                         const u8 initval, const enum grid_kind kind,
+                         const u8 guard) {
+    return grid_alloc(columns, rows, initval, kind, 1, guard);
+}
+
 void grid_free(grid *grid) {
     if (grid != NULL) {
-        free(grid->cells);
+        u8 *base = grid->cells - (grid->guard ? grid->stride : 0);
+        if (grid->kind == GRID_MMAP) {
+            munmap(base, (grid_size(grid) + GRID_ALIGN - 1) &
+                         ~(u64)(GRID_ALIGN - 1));
+        } else {
+            free(base);
+        }
         free(grid);
     }
 }
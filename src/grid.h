@@ -6,10 +6,40 @@
 
 #include "types.h"
 
+/**
+ * Storage used for the cells of a grid. Byte grids hold one value per
+ * byte, bit grids pack eight boolean cells per byte and mmap grids are byte
+ * grids backed by an unlinked temporary file so the page cache, rather than
+ * the heap, holds them.
+ */
+enum grid_kind {
+    GRID_BYTES,
+    GRID_BITS,
+    GRID_MMAP,
+};
+
+/** Alignment of the cell storage and of each row of long rows. */
+#define GRID_ALIGN 64
+
+/**
+ * Cells are stored a row at a time, `stride` bytes apart. The stride of rows
+ * of 64 bytes or more is a multiple of GRID_ALIGN, shorter rows are padded
+ * to a power of two of at least 8 bytes, so every row starts on a boundary
+ * of its own size and covers whole 64 bit words. Padding holds the initial
+ * value, and there is always room for one cell past the end of a row.
+ *
+ * A guarded grid also has a ring of cells around it, at columns -1 and
+ * `columns` and rows -1 and `rows`, so kernels can read a cell's neighbours
+ * without edge checks. Column -1 of a row shares storage with the padding at
+ * the end of the row above.
+ */
 typedef struct {
     u32 columns;
     u32 rows;
     u8 *cells;
+    u64 stride;
+    u8 guard;
+    enum grid_kind kind;
 } grid;
 
 /**
@@ -22,9 +52,74 @@ grid* grid_alloc_init(const u32 columns,
                       const u32 rows,
                       const u8 initval);
 
+/**
+ * Allocate a grid of dimensions `columns` x `rows` using the storage given
+ * by `kind`. Initialize all cells to `initval` (bit grids only keep the
+ * lowest bit).
+ *
+ * @return grid* Pointer to new allocated grid or NULL if allocation failed.
+ */
+grid* grid_alloc_kind(const u32 columns,
+                      const u32 rows,
+                      const u8 initval,
+                      const enum grid_kind kind);
+
+/**
+ * Allocate a grid like `grid_alloc_kind`, with a guard ring of cells set to
+ * `guard` around it.
+ *
+ * @return grid* Pointer to new allocated grid or NULL if allocation failed.
+ */
+grid* grid_alloc_guarded(const u32 columns,
+                         const u32 rows,
+                         const u8 initval,
+                         const enum grid_kind kind,
+                         const u8 guard);
+
+/** Bytes from one row of a `columns` wide grid of `kind` to the next. */
+u64 grid_stride(const u32 columns, const enum grid_kind kind);
+
+/**
+ * Number of bytes needed to store the cells of a `columns` x `rows` grid
+ * using the storage given by `kind`, without a guard ring.
+ */
+u64 grid_cell_bytes(const u32 columns, const u32 rows,
+                    const enum grid_kind kind);
+
+/** Name of a grid storage kind, for diagnostics. */
+const char* grid_kind_name(const enum grid_kind kind);
+
 /**
  * Free the memory allocated for a grid.
  */
 void grid_free(grid *grid);
 
+/**
+ * First byte of row `y`. The guard row above row 0, if any, starts `stride`
+ * bytes before row 0.
+ */
+static inline u8* grid_row(const grid *g, const u32 y) {
+    return g->cells + (u64)y * g->stride;
+}
+
+/** Read the cell at `x`, `y`. */
+static inline u8 grid_get(const grid *g, const u32 x, const u32 y) {
+    const u8 *row = grid_row(g, y);
+    if (g->kind == GRID_BITS) {
+        return (row[x >> 3] >> (x & 7)) & 1;
+    }
+    return row[x];
+}
+
+/** Write `v` to the cell at `x`, `y`. */
+static inline void grid_set(grid *g, const u32 x, const u32 y, const u8 v) {
+    u8 *row = grid_row(g, y);
+    if (g->kind == GRID_BITS) {
+        const u8 bit = (u8)(1u << (x & 7));
+        row[x >> 3] = v ? (row[x >> 3] | bit) : (row[x >> 3] & (u8)~bit);
+        return;
+    }
+    row[x] = v;
+}
+
 #endif /* GRID_H */
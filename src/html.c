@@ -0,0 +1,160 @@
+/** @brief HTML canvas output implementation */
+#include "html.h"
+
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Payload bytes encoded per write, a multiple of 6. */
+#define HTML_CHUNK (3u << 16)
+
+static const char html_alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+#define LANES(b) (0x0101010101010101ull * (b))
+
+/* Add bytes lane by lane, without carries between lanes. */
+static inline u64 swar_add(u64 x, u64 y) {
+    const u64 high = LANES(0x80);
+    return ((x & ~high) + (y & ~high)) ^ ((x ^ y) & high);
+}
+
+/* 0xFF in lanes holding at least `t`, for lanes below 128. */
+static inline u64 swar_ge(u64 x, u8 t) {
+    const u64 high = (x + LANES(128 - t)) & LANES(0x80);
+    return (high >> 7) * 0xFF;
+}
+
+/*
+ * Map eight 6 bit values, one per byte, to base64 characters. Each range of
+ * the alphabet is a fixed offset from the value: 'A' for 0-25, then 6 more
+ * for 'a'-'z', 75 fewer for '0'-'9', 15 fewer for '+' and 3 more for '/'.
+ */
+static inline u64 swar_base64(u64 x) {
+    u64 offset = LANES('A');
+    offset = swar_add(offset, swar_ge(x, 26) & LANES(6));
+    offset = swar_add(offset, swar_ge(x, 52) & LANES((u8)-75));
+    offset = swar_add(offset, swar_ge(x, 62) & LANES((u8)-15));
+    offset = swar_add(offset, swar_ge(x, 63) & LANES(3));
+    return swar_add(x, offset);
+}
+
+u64 html_base64(char *out, const u8 *in, u64 len) {
+    char *start = out;
+    u64 i = 0;
+    for (; i + 6 <= len; i += 6) {
+        const u64 v = (u64)in[i] << 40 | (u64)in[i + 1] << 32 |
+                      (u64)in[i + 2] << 24 | (u64)in[i + 3] << 16 |
+                      (u64)in[i + 4] << 8 | (u64)in[i + 5];
+        /* Spread the sextets into bytes, the first in the lowest. */
+        u64 lanes = 0;
+        for (u32 k = 0; k < 8; ++k) {
+            lanes |= ((v >> (42 - 6 * k)) & 63) << (8 * k);
+        }
+        lanes = swar_base64(lanes);
+        for (u32 k = 0; k < 8; ++k) {
+            out[k] = (char)(lanes >> (8 * k));
+        }
+        out += 8;
+    }
+
+    for (; i < len; i += 3) {
+        const u64 rest = len - i;
+        const u32 v = (u32)in[i] << 16 |
+                      (rest > 1 ? (u32)in[i + 1] << 8 : 0) |
+                      (rest > 2 ? (u32)in[i + 2] : 0);
+        out[0] = html_alphabet[(v >> 18) & 63];
+        out[1] = html_alphabet[(v >> 12) & 63];
+        out[2] = (rest > 1) ? html_alphabet[(v >> 6) & 63] : '=';
+        out[3] = (rest > 2) ? html_alphabet[v & 63] : '=';
+        out += 4;
+    }
+    return (u64)(out - start);
+}
+
+/* Pack the east and south walls of every corridor cell. */
+static u8* html_pack(const grid *maze, u32 columns, u32 rows, u64 *len) {
+    const u64 cells = (u64)columns * rows;
+    *len = (cells + 3) / 4;
+    u8 *bits = calloc(*len ? *len : 1, 1);
+    if (bits == NULL) {
+        return NULL;
+    }
+
+    u64 i = 0;
+    for (u32 y = 0; y < rows; ++y) {
+        for (u32 x = 0; x < columns; ++x, ++i) {
+            const u8 walls = (u8)(grid_get(maze, 2 * x + 2, 2 * y + 1) |
+                                  grid_get(maze, 2 * x + 1, 2 * y + 2) << 1);
+            bits[i >> 2] |= (u8)(walls << ((i & 3) * 2));
+        }
+    }
+    return bits;
+}
+
+/* Write `s` inside a single quoted script string. */
+static i64 html_js_string(FILE *out, const char *s) {
+    i64 n = 0;
+    for (; *s; ++s) {
+        if (*s == '\'' || *s == '\\' || *s == '<' || (u8)*s < 0x20) {
+            n += fprintf(out, "\\x%02x", (u8)*s);
+        } else {
+            fputc(*s, out);
+            ++n;
+        }
+    }
+    return n;
+}
+
+i64 html_draw(FILE *out, const grid *maze, const struct svg_opts *opts) {
+    const u32 columns = maze->columns / 2;
+    const u32 rows = maze->rows / 2;
+    const u32 cw = opts->corridor_width;
+    const u32 pen = opts->pen_radius;
+
+    u64 len;
+    u8 *bits = html_pack(maze, columns, rows, &len);
+    char *chunk = malloc(HTML_CHUNK / 3 * 4);
+    if (bits == NULL || chunk == NULL) {
+        fprintf(stderr, "Unable to allocate memory for HTML payload\n");
+        free(bits);
+        free(chunk);
+        return -1;
+    }
+
+    i64 n = 0;
+    n += fprintf(out, "<!DOCTYPE html>\n<html><head><meta charset='utf-8'>"
+                 "<title>svgmaze</title></head><body>\n");
+    n += fprintf(out, "<canvas id='maze' width='%llu' height='%llu'>"
+                 "</canvas>\n",
+                 (unsigned long long)columns * cw + pen,
+                 (unsigned long long)rows * cw + pen);
+    n += fprintf(out, "<script>\n(function(){var w=%u,h=%u,c=%u,p=%u,"
+                 "f='", columns, rows, cw, pen);
+    n += html_js_string(out, opts->fg_color);
+    n += fprintf(out, "',d=atob('");
+
+    TRACE_BEGIN("base64");
+    for (u64 pos = 0; pos < len; pos += HTML_CHUNK) {
+        const u64 take = (len - pos < HTML_CHUNK) ? len - pos : HTML_CHUNK;
+        const u64 chars = html_base64(chunk, bits + pos, take);
+        fwrite(chunk, 1, chars, out);
+        n += (i64)chars;
+    }
+    TRACE_END("base64");
+
+    n += fprintf(out, "'),g=document.getElementById('maze')"
+                 ".getContext('2d');\n"
+                 "g.strokeStyle=f;g.lineWidth=p;g.lineCap='round';"
+                 "g.translate(p/2,p/2);g.beginPath();"
+                 "g.rect(0,0,w*c,h*c);\n"
+                 "for(var y=0,i=0;y<h;y++)for(var x=0;x<w;x++,i++){"
+                 "var b=d.charCodeAt(i>>2)>>((i&3)*2);\n"
+                 "if(b&1){g.moveTo((x+1)*c,y*c);g.lineTo((x+1)*c,(y+1)*c);}\n"
+                 "if(b&2){g.moveTo(x*c,(y+1)*c);g.lineTo((x+1)*c,(y+1)*c);}}\n"
+                 "g.stroke();})();\n</script></body></html>\n");
+
+    free(chunk);
+    free(bits);
+    return n;
+}
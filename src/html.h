@@ -0,0 +1,37 @@
+/**
+ * @brief HTML canvas output
+ *
+ * Draw a maze as a small HTML page: the walls are packed two bits per
+ * corridor cell, base64 encoded into the page, and drawn onto a canvas by
+ * an inline script.
+ */
+#ifndef HTML_H
+#define HTML_H
+
+#include <stdio.h>
+
+#include "types.h"
+#include "grid.h"
+#include "maze.h"
+
+/**
+ * Draw `maze` to `out` as an HTML page whose script draws the maze with
+ * the style of `maze_draw_svg`.
+ *
+ * The payload holds, for corridor cell i in row order, bit 2i for its east
+ * wall and bit 2i + 1 for its south wall; the outer walls are implied.
+ *
+ * @return Number of bytes written, or -1 if memory could not be allocated.
+ */
+i64 html_draw(FILE *out, const grid *maze, const struct svg_opts *opts);
+
+/**
+ * Base64 encode `len` bytes of `in` into `out`, which must have room for
+ * 4 * ((len + 2) / 3) characters. Six bytes at a time are encoded as
+ * eight characters in parallel in a 64 bit word.
+ *
+ * @return Number of characters written.
+ */
+u64 html_base64(char *out, const u8 *in, u64 len);
+
+#endif /* HTML_H */
@@ -0,0 +1,396 @@
+/** @brief Single maze jobs implementation */
+#include "job.h"
+
+#include "version.h"
+#include "prng.h"
+#include "plan.h"
+#include "record.h"
+#include "archive.h"
+#include "fill.h"
+#include "qoi.h"
+#include "braille.h"
+#include "html.h"
+#include "gif.h"
+#include "nest.h"
+#include "stream.h"
+#include "rowsolve.h"
+#include "tri.h"
+#include "timer.h"
+#include "trace.h"
+#include <string.h>
+
+
+const char* job_extension(const char *output) {
+    if (0 == strcmp("svg", output) || 0 == strcmp("svgdash", output) ||
+        0 == strcmp("svgfill", output)) {
+        return "svg";
+    }
+    if (0 == strcmp("record", output)) {
+        return "rec";
+    }
+    if (0 == strcmp("gif", output)) {
+        return "gif";
+    }
+    if (0 == strcmp("arc", output)) {
+        return "arc";
+    }
+    if (0 == strcmp("qoi", output)) {
+        return "qoi";
+    }
+    if (0 == strcmp("html", output)) {
+        return "html";
+    }
+    return "txt";
+}
+
+/**
+ * Does the job draw a maze grid as SVG? `opts` gets the job's SVG options,
+ * with those implied by the output format.
+ */
+static int job_svg(const struct maze_job *job, struct svg_opts *opts) {
+    *opts = *job->svg;
+    if (0 == strcmp("svgdash", job->output)) {
+        opts->dash = 1;
+        return 1;
+    }
+    return (0 == strcmp("svg", job->output));
+}
+
+/* Triangular mazes are small enough to always keep in memory. */
+static i64 job_run_tri(const struct maze_job *job, FILE *out,
+                       struct stats *stats) {
+    if (0 != strcmp("svg", job->output)) {
+        fprintf(stderr, "Unable to draw triangular maze as %s\n",
+                job->output);
+        return -1;
+    }
+
+    u64 t0 = timer_ns();
+    TRACE_BEGIN("generate");
+    tri_grid *maze = tri_generate(job->columns, job->rows);
+    TRACE_END("generate");
+    if (maze == NULL) {
+        return -1;
+    }
+
+    u64 t1 = timer_ns();
+    TRACE_BEGIN("render");
+    i64 n = (i64)tri_draw_svg(out, maze, job->svg);
+    TRACE_END("render");
+
+    if (stats) {
+        u64 t2 = timer_ns();
+        stats_record(stats, STATS_GENERATE, t1 - t0);
+        stats_record(stats, STATS_RENDER, t2 - t1);
+    }
+
+    tri_free(maze);
+    return n;
+}
+
+/**
+ * The solver `job` asks for on a maze of `columns` x `rows` corridors held
+ * in a grid of `kind`. Mapped grids may not fit in memory, so are searched
+ * in order. Ends far apart leave A* little to skip, while filling covers
+ * every cell much faster.
+ */
+static const char* job_solver(const struct maze_job *job, u32 columns,
+                              u32 rows, enum grid_kind kind) {
+    const char *solver = job->solver ? job->solver : "auto";
+    if (0 != strcmp("auto", solver)) {
+        return solver;
+    }
+    const struct solve_ends ends = solve_ends_at(job->solve, columns, rows);
+    const u64 span = (ends.from_x > ends.to_x)
+        ? (u64)ends.from_x - ends.to_x : (u64)ends.to_x - ends.from_x;
+    const u64 rise = (ends.from_y > ends.to_y)
+        ? (u64)ends.from_y - ends.to_y : (u64)ends.to_y - ends.from_y;
+    return (kind == GRID_MMAP) ? "bfs"
+         : (4 * (span + rise) >= (u64)columns + rows) ? "fill"
+         : "astar";
+}
+
+/**
+ * Choose the representation of a rectangular maze, logging the choice.
+ *
+ * @return 0 on success, -1 if the maze cannot be made.
+ */
+static int job_plan(const struct maze_job *job, int record,
+                    enum plan_repr *repr) {
+    /* A nested maze is planned at its finest level. */
+    const int nested = (job->nest_columns > 0);
+    u64 columns = job->columns;
+    u64 rows = job->rows;
+    if (nested) {
+        if (record) {
+            fprintf(stderr, "Unable to record a nested maze\n");
+            return -1;
+        }
+        columns *= job->nest_columns;
+        rows *= job->nest_rows;
+        if (columns > MAZE_MAX_SIDE || rows > MAZE_MAX_SIDE) {
+            fprintf(stderr, "Unable to nest %ux%u mazes in a %ux%u maze\n",
+                    job->nest_columns, job->nest_rows,
+                    job->columns, job->rows);
+            return -1;
+        }
+    }
+
+    /* Archives, images, Braille, dashed and filled SVG need the whole
+     * grid. */
+    const int whole = (0 == strcmp("arc", job->output)) ||
+                      (0 == strcmp("qoi", job->output)) ||
+                      (0 == strcmp("html", job->output)) ||
+                      (0 == strcmp("braille", job->output)) ||
+                      (0 == strcmp("svgdash", job->output)) ||
+                      (0 == strcmp("svgfill", job->output));
+
+    /* A solver's working set sits beside the maze. */
+    u64 extra[PLAN_REPRS] = {0};
+    for (u32 k = 0; job->solve && k < PLAN_REPRS; ++k) {
+        extra[k] = (k == PLAN_STREAM)
+            ? rowsolve_bytes((u32)columns)
+            : solve_memory(job_solver(job, (u32)columns, (u32)rows,
+                                      plan_grid_kind((enum plan_repr)k)),
+                           (u32)columns, (u32)rows);
+    }
+
+    /* Streamed mazes differ from the others, so whether to stream is up to
+     * the maze alone, and solving never changes the maze drawn. Every grid
+     * holds the same maze, so one with room for the solver is taken. */
+    *repr = plan_choose((u32)columns, (u32)rows, job->max_mem,
+                        !record && !nested && !whole, NULL);
+    if (job->solve && *repr != PLAN_STREAM) {
+        *repr = plan_choose((u32)columns, (u32)rows, job->max_mem, 0, extra);
+    }
+    if (nested && *repr == PLAN_BITS) {
+        /* Sub-mazes are carved concurrently, and would share bytes. */
+        *repr = PLAN_MMAP;
+    }
+    u64 estimate = plan_memory((u32)columns, (u32)rows, *repr) + extra[*repr];
+    if (job->verbose) {
+        fprintf(stderr, "%s: %llux%llu maze, %s representation "
+                "(estimated %llu bytes, budget %llu bytes)\n",
+                APPMETA_NAME, (unsigned long long)columns,
+                (unsigned long long)rows, plan_repr_name(*repr),
+                (unsigned long long)estimate,
+                (unsigned long long)job->max_mem);
+    }
+    if (job->max_mem && estimate > job->max_mem) {
+        fprintf(stderr, "%s: warning: %llux%llu maze may exceed --max-mem\n",
+                APPMETA_NAME, (unsigned long long)columns,
+                (unsigned long long)rows);
+    }
+    return 0;
+}
+
+/* Generate the grid of a rectangular maze that is not streamed. */
+static grid* job_grid(const struct maze_job *job, enum plan_repr repr,
+                      struct maze_record *rec, struct stats *stats) {
+    u64 t0 = timer_ns();
+    TRACE_BEGIN("generate");
+    grid *maze = (job->nest_columns > 0)
+        ? nest_generate(job->columns, job->rows,
+                        job->nest_columns, job->nest_rows,
+                        plan_grid_kind(repr))
+        : maze_generate_kind(job->columns, job->rows, plan_grid_kind(repr),
+                             rec);
+    TRACE_END("generate");
+    if (maze && stats) {
+        stats_record(stats, STATS_GENERATE, timer_ns() - t0);
+    }
+    return maze;
+}
+
+/* Solve the maze of `job` between the ends it asks for. */
+static grid* job_solve(const struct maze_job *job, const grid *maze) {
+    const u32 columns = maze->columns / 2;
+    const u32 rows = maze->rows / 2;
+    const struct solve_ends ends = solve_ends_at(job->solve, columns, rows);
+    const char *solver = job_solver(job, columns, rows, maze->kind);
+
+    u64 visited;
+    grid *solution;
+    TRACE_BEGIN("solve");
+    if (0 == strcmp("bfs", solver)) {
+        solution = solve_bfs_external(maze, &ends, &visited);
+    } else if (0 == strcmp("fill", solver)) {
+        solution = solve_fill(maze, &ends, &visited);
+    } else {
+        solution = solve_astar(maze, &ends, &visited);
+    }
+    TRACE_END("solve");
+    if (solution && job->verbose) {
+        fprintf(stderr, "%s: solved %u,%u to %u,%u by %s in %llu steps, "
+                "maze of %llu cells\n", APPMETA_NAME, ends.from_x,
+                ends.from_y, ends.to_x, ends.to_y, solver,
+                (unsigned long long)visited,
+                (unsigned long long)columns * rows);
+    }
+    return solution;
+}
+
+i64 job_run(const struct maze_job *job, FILE *out, struct stats *stats) {
+    struct svg_opts svg_opts;
+    const int svg = job_svg(job, &svg_opts);
+    const int gif = (0 == strcmp("gif", job->output));
+    const int record = gif || (0 == strcmp("record", job->output));
+
+    prng_srand(job->seed);
+
+    if (job->solve && !svg && 0 != strcmp("ascii", job->output)) {
+        fprintf(stderr, "Unable to draw a solution as %s\n", job->output);
+        return -1;
+    }
+
+    if (job->topology && 0 == strcmp("tri", job->topology)) {
+        if (job->solve) {
+            fprintf(stderr, "Unable to solve a triangular maze\n");
+            return -1;
+        }
+        return job_run_tri(job, out, stats);
+    }
+
+    enum plan_repr repr;
+    if (job_plan(job, record, &repr) != 0) {
+        return -1;
+    }
+
+    if (repr == PLAN_STREAM) {
+        /* Generation and drawing are interleaved, count it all as render */
+        u64 t0 = timer_ns();
+        struct rowsolve rs;
+        struct rowsolve *solution = NULL;
+        if (job->solve) {
+            /* Solved on a first pass, and streamed again to draw. */
+            const struct solve_ends ends =
+                solve_ends_at(job->solve, job->columns, job->rows);
+            if (rowsolve_open(&rs, job->columns, job->rows, &ends) != 0) {
+                return -1;
+            }
+            solution = &rs;
+            prng_srand(job->seed);
+        }
+        TRACE_BEGIN("stream");
+        i64 n = svg
+            ? maze_stream_draw_svg(out, job->columns, job->rows, &svg_opts,
+                                   solution)
+            : maze_stream_draw_ascii(out, job->columns, job->rows, "#", " ",
+                                     solution);
+        TRACE_END("stream");
+        if (solution) {
+            rowsolve_close(solution);
+        }
+        if (stats) {
+            stats_record(stats, STATS_RENDER, timer_ns() - t0);
+        }
+        return n;
+    }
+
+    struct maze_record rec = {0};
+    grid *maze = job_grid(job, repr, record ? &rec : NULL, stats);
+    if (maze == NULL) {
+        maze_record_free(&rec);
+        return -1;
+    }
+
+    grid *solution = NULL;
+    if (job->solve) {
+        solution = job_solve(job, maze);
+        if (solution == NULL) {
+            grid_free(maze);
+            return -1;
+        }
+        svg_opts.solution = solution;
+    }
+
+    u64 t1 = timer_ns();
+    TRACE_BEGIN("render");
+    i64 n;
+    if (gif) {
+        n = gif_draw_walk(out, &rec, job->columns, job->rows,
+                          svg_opts.corridor_width, job->frames);
+        maze_record_free(&rec);
+    } else if (record) {
+        n = record_write(out, &rec, job->columns, job->rows);
+        maze_record_free(&rec);
+    } else if (0 == strcmp("arc", job->output)) {
+        n = archive_write(out, maze, job->seed);
+    } else if (0 == strcmp("svgfill", job->output)) {
+        n = fill_draw_svg(out, maze, &svg_opts);
+    } else if (0 == strcmp("qoi", job->output)) {
+        n = qoi_draw(out, maze, svg_opts.corridor_width);
+    } else if (0 == strcmp("braille", job->output)) {
+        n = (i64)braille_draw_band(out, maze, 0, 1);
+    } else if (0 == strcmp("html", job->output)) {
+        n = html_draw(out, maze, &svg_opts);
+    } else if (svg) {
+        n = (i64)maze_draw_svg(out, maze, &svg_opts);
+    } else if (solution) {
+        n = (i64)solve_draw_ascii(out, maze, solution);
+    } else {
+        n = (i64)maze_draw_ascii(out, maze, "#", " ");
+    }
+    TRACE_END("render");
+
+    if (stats) {
+        stats_record(stats, STATS_RENDER, timer_ns() - t1);
+    }
+
+    grid_free(solution);
+    grid_free(maze);
+    return n;
+}
+
+int job_generate(const struct maze_job *job, grid **maze,
+                 struct stats *stats) {
+    struct svg_opts svg_opts;
+    const int svg = job_svg(job, &svg_opts);
+    const int ascii = (0 == strcmp("ascii", job->output));
+    const int braille = (0 == strcmp("braille", job->output));
+    if ((!svg && !ascii && !braille) || job->solve ||
+        (job->topology && 0 == strcmp("tri", job->topology))) {
+        return 0;
+    }
+
+    /* A streamed maze has no grid to share between bands. */
+    if (job->nest_columns == 0 && !svg_opts.dash && !braille &&
+        plan_choose(job->columns, job->rows, job->max_mem, 1, NULL) ==
+        PLAN_STREAM) {
+        return 0;
+    }
+
+    prng_srand(job->seed);
+
+    enum plan_repr repr;
+    if (job_plan(job, 0, &repr) != 0) {
+        return -1;
+    }
+
+    *maze = job_grid(job, repr, NULL, stats);
+    return (*maze != NULL) ? 1 : -1;
+}
+
+i64 job_draw_band(const struct maze_job *job, const grid *maze, FILE *out,
+                  u32 band, u32 bands) {
+    struct svg_opts svg_opts;
+    if (job_svg(job, &svg_opts)) {
+        return (i64)maze_draw_svg_band(out, maze, &svg_opts, band, bands);
+    }
+    if (0 == strcmp("braille", job->output)) {
+        return (i64)braille_draw_band(out, maze, band, bands);
+    }
+    return (i64)maze_draw_ascii_band(out, maze, "#", " ", band, bands);
+}
+
+u64 job_size_band(const struct maze_job *job, const grid *maze,
+                  u32 band, u32 bands) {
+    struct svg_opts svg_opts;
+    if (job_svg(job, &svg_opts)) {
+        return maze_size_svg_band(maze, &svg_opts, band, bands);
+    }
+    if (0 == strcmp("braille", job->output)) {
+        return braille_size_band(maze, band, bands);
+    }
+    return maze_size_ascii_band(maze, "#", " ", band, bands);
+}
@@ -0,0 +1,85 @@
+/**
+ * @brief Single maze jobs
+ *
+ * Generate one maze with the representation chosen for its memory budget
+ * and draw it in the requested output format.
+ */
+#ifndef JOB_H
+#define JOB_H
+
+#include <stdio.h>
+
+#include "types.h"
+#include "maze.h"
+#include "stats.h"
+#include "solve.h"
+
+struct maze_job {
+    u64 seed;
+    u32 columns;
+    u32 rows;
+
+    /** Corridors of the sub-maze in each cell, 0 for a plain maze. */
+    u32 nest_columns;
+    u32 nest_rows;
+
+    /** Memory budget in bytes, 0 for unlimited. */
+    u64 max_mem;
+    /** Cell topology name (rect|tri). */
+    const char *topology;
+    /**
+     * Output format name
+     * (svg|svgdash|svgfill|ascii|braille|html|record|gif|arc|qoi).
+     */
+    const char *output;
+    const struct svg_opts *svg;
+    /** Frames of animated output. */
+    u32 frames;
+    /** Ends of a solution to draw over svg or ascii output, or NULL. */
+    const struct solve_ends *solve;
+    /** Solver name (auto|astar|fill|bfs), NULL for auto. */
+    const char *solver;
+
+    /** Log the chosen representation to stderr. */
+    u8 verbose;
+};
+
+/**
+ * Generate and draw the maze described by `job` to `out`. If `stats` is not
+ * NULL, generate and render latencies are recorded there.
+ *
+ * @return Number of bytes written, or -1 on failure.
+ */
+i64 job_run(const struct maze_job *job, FILE *out, struct stats *stats);
+
+/**
+ * Generate the maze of `job` into `maze` for drawing in bands with
+ * `job_draw_band`. Only svg, ascii and braille output of rectangular mazes
+ * that are held in a grid, without a solution, can be drawn in bands, any
+ * other job should be given to `job_run` instead.
+ *
+ * @return 1 if the maze was generated, 0 if the job cannot be drawn in
+ *         bands, or -1 on failure.
+ */
+int job_generate(const struct maze_job *job, grid **maze,
+                 struct stats *stats);
+
+/**
+ * Draw band `band` of `bands` of a maze generated by `job_generate` to
+ * `out`. The bands written in order make up the output of `job_run`.
+ *
+ * @return Number of bytes written.
+ */
+i64 job_draw_band(const struct maze_job *job, const grid *maze, FILE *out,
+                  u32 band, u32 bands);
+
+/**
+ * Number of bytes `job_draw_band` would write, computed without drawing.
+ */
+u64 job_size_band(const struct maze_job *job, const grid *maze,
+                  u32 band, u32 bands);
+
+/** File name extension for an output format. */
+const char* job_extension(const char *output);
+
+#endif /* JOB_H */
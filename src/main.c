@@ -20,6 +20,7 @@
  * entry/exits are desired, since the maze is fully explored, any two boundary
  * cells should be connected though the difficulty of the maze may vary.
  */
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -31,8 +32,16 @@
 #include "prng.h"
 #include "grid.h"
 #include "maze.h"
-
-#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#include "trace.h"
+#include "job.h"
+#include "batch.h"
+#include "pool.h"
+#include "record.h"
+#include "archive.h"
+#include "fill.h"
+#include "share.h"
+#include "outfile.h"
+#include "find.h"
 
 struct main_opts {
     u64 random_seed;
@@ -44,9 +53,126 @@ struct main_opts {
 
     const char *fg_color;
     const char *output;
+    const char *topology;
+
+    u64 max_mem;
+    u8 verbose;
+
+    u64 batch_count;
+    u32 threads;
+    const char *batch_dir;
+    const char *jobs;
+    u64 shard;
+    u64 shards;
+
+    const char *play;
+    u32 frames;
+    const char *decode;
+    const char *memfd;
+    const char *out;
+
+    u32 nest_columns;
+    u32 nest_rows;
+
+    u8 solve;
+    struct solve_ends ends;
+    const char *solver;
+
+    u64 find;
+    double min_path;
+    double max_dead;
 };
 
 
+/**
+ * Match a long option `--name=value`, `arg` points past the leading "--".
+ *
+ * @return Pointer to the value, or NULL if `arg` is not the named option.
+ */
+static const char* long_opt(const char *arg, const char *name) {
+    size_t n = strlen(name);
+    if (strncmp(arg, name, n) == 0 && arg[n] == '=') {
+        return arg + n + 1;
+    }
+    return NULL;
+}
+
+
+/**
+ * Parse a maze side of 1 to MAZE_MAX_SIDE corridors into `side`.
+ *
+ * @return 0 on success, -1 if `str` is not a valid side.
+ */
+static int side_opt(const char *str, u32 *side) {
+    if (*str < '0' || *str > '9') {
+        return -1;
+    }
+    char *end;
+    errno = 0;
+    const unsigned long long n = strtoull(str, &end, 10);
+    if (*end != '\0' || errno == ERANGE || n == 0 || n > MAZE_MAX_SIDE) {
+        return -1;
+    }
+    *side = (u32)n;
+    return 0;
+}
+
+/**
+ * Parse a percentage from 0 to 100 into `percent`.
+ *
+ * @return 0 on success, -1 if `str` is not a percentage.
+ */
+static int percent_opt(const char *str, double *percent) {
+    char *end;
+    *percent = strtod(str, &end);
+    if (end == str || *end != '\0' || !(*percent >= 0.0) ||
+        *percent > 100.0) {
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * Draw every maze of the archive at `path` to stdout as `output`.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int main_decode(const char *path, const char *output,
+                       struct svg_opts *svg_opts) {
+    const int dash = (0 == strcmp("svgdash", output));
+    const int filled = (0 == strcmp("svgfill", output));
+    const int svg = dash || (0 == strcmp("svg", output));
+    if (!svg && !filled && 0 != strcmp("ascii", output)) {
+        fprintf(stderr, "Unable to draw archived mazes as %s\n", output);
+        return -1;
+    }
+
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return -1;
+    }
+
+    svg_opts->dash = (u8)dash;
+    grid *maze;
+    u64 seed;
+    int got;
+    while ((got = archive_read(in, &maze, &seed)) > 0) {
+        if (filled) {
+            fill_draw_svg(stdout, maze, svg_opts);
+        } else if (svg) {
+            maze_draw_svg(stdout, maze, svg_opts);
+        } else {
+            maze_draw_ascii(stdout, maze, "#", " ");
+        }
+        grid_free(maze);
+    }
+    fclose(in);
+    return got;
+}
+
+
 int main(int argc, char *argv[]) {
 
     /* Option Defaults */
@@ -59,12 +185,42 @@ int main(int argc, char *argv[]) {
         .pen_radius = 1,
         .fg_color = "black",
         .output = "ascii",
+        .topology = "rect",
+
+        .max_mem = 0,
+        .verbose = 0,
+
+        .batch_count = 0,
+        .threads = 0,
+        .batch_dir = ".",
+        .jobs = NULL,
+        .shard = 0,
+        .shards = 0,
+
+        .play = NULL,
+        .frames = 100,
+        .decode = NULL,
+        .memfd = NULL,
+        .out = NULL,
+
+        .nest_columns = 0,
+        .nest_rows = 0,
+
+        .solve = 0,
+        .ends = {0, 0, SOLVE_LAST, SOLVE_LAST},
+        .solver = "auto",
+
+        .find = 0,
+        .min_path = 0.0,
+        .max_dead = 100.0,
     };
 
     /* Process arguments: */
+    u64 last_seed;
     u8 args = 1;
     for (int k = 1; args && (k < argc); ++k) {
         const char *arg = argv[k];
+        const char *val;
 
         if (*arg++ != '-')
             goto usage;
@@ -74,6 +230,16 @@ int main(int argc, char *argv[]) {
             if (!*arg)
                 goto usage;
 
+            /* A numeric range runs a batch of those seeds, and a range
+             * of every seed has a count too large to hold. */
+            int range = strrange(arg, &opts.random_seed, &last_seed);
+            if (range < 0 ||
+                (range == 0 && last_seed - opts.random_seed == UINT64_MAX))
+                goto usage;
+            if (range == 0) {
+                opts.batch_count = last_seed - opts.random_seed + 1;
+                continue;
+            }
             opts.random_seed = strhash(arg);
             continue;
 
@@ -81,16 +247,17 @@ int main(int argc, char *argv[]) {
             if (!*arg)
                 goto usage;
 
-            opts.columns = (u32)strtoul(arg, NULL, 10);
-            opts.rows = MIN(300, opts.columns);
+            if (side_opt(arg, &opts.columns) != 0)
+                goto usage;
+            opts.rows = opts.columns;
             continue;
 
         case 'h':              /* Set Height  */
             if (!*arg)
                 goto usage;
 
-            opts.rows = (u32)strtoul(arg, NULL, 10);
-            opts.rows = MIN(300, opts.rows);
+            if (side_opt(arg, &opts.rows) != 0)
+                goto usage;
             continue;
 
         case 'c':              /* Set Corridor width (SVG output) */
@@ -121,7 +288,141 @@ int main(int argc, char *argv[]) {
             opts.fg_color = arg;
             continue;
 
-        case '-':              /* End of arguments.    */
+        case 'n':              /* Batch: number of mazes  */
+            if (!*arg)
+                goto usage;
+
+            opts.batch_count = strtoull(arg, NULL, 10);
+            continue;
+
+        case 'j':              /* Worker threads  */
+            if (!*arg)
+                goto usage;
+
+            opts.threads = (u32)strtoul(arg, NULL, 10);
+            continue;
+
+        case 'd':              /* Batch: output directory  */
+            if (!*arg)
+                goto usage;
+
+            opts.batch_dir = arg;
+            continue;
+
+        case 'T':              /* Log decisions to stderr.  */
+            opts.verbose = 1;
+            break;
+
+        case '-':              /* Long options.  */
+            if ((val = long_opt(arg, "max-mem"))) {
+                if (strsize(val, &opts.max_mem) != 0)
+                    goto usage;
+                continue;
+            }
+            if ((val = long_opt(arg, "topology"))) {
+                if (strcmp(val, "rect") != 0 && strcmp(val, "tri") != 0)
+                    goto usage;
+                opts.topology = val;
+                continue;
+            }
+            if ((val = long_opt(arg, "jobs"))) {
+                opts.jobs = val;
+                continue;
+            }
+            if ((val = long_opt(arg, "shard"))) {
+                char *end;
+                opts.shard = strtoull(val, &end, 10);
+                if (end == val || *end++ != '/')
+                    goto usage;
+                opts.shards = strtoull(end, &end, 10);
+                if (*end || opts.shard >= opts.shards)
+                    goto usage;
+                continue;
+            }
+            if ((val = long_opt(arg, "nest"))) {
+                char *end;
+                opts.nest_columns = (u32)strtoul(val, &end, 10);
+                if (*end++ != 'x')
+                    goto usage;
+                opts.nest_rows = (u32)strtoul(end, &end, 10);
+                if (*end || !opts.nest_columns || !opts.nest_rows)
+                    goto usage;
+                continue;
+            }
+            if (strcmp(arg, "solve") == 0) {
+                opts.solve = 1;
+                continue;
+            }
+            if ((val = long_opt(arg, "solve"))) {
+                char *end;
+                opts.ends.from_x = (u32)strtoul(val, &end, 10);
+                if (end == val || *end++ != ',')
+                    goto usage;
+                opts.ends.from_y = (u32)strtoul(end, &end, 10);
+                if (*end++ != ':')
+                    goto usage;
+                opts.ends.to_x = (u32)strtoul(end, &end, 10);
+                if (*end++ != ',')
+                    goto usage;
+                opts.ends.to_y = (u32)strtoul(end, &end, 10);
+                if (*end)
+                    goto usage;
+                opts.solve = 1;
+                continue;
+            }
+            if ((val = long_opt(arg, "solver"))) {
+                if (strcmp(val, "auto") != 0 && strcmp(val, "astar") != 0 &&
+                    strcmp(val, "fill") != 0 && strcmp(val, "bfs") != 0)
+                    goto usage;
+                opts.solver = val;
+                continue;
+            }
+            if ((val = long_opt(arg, "find"))) {
+                opts.find = strtoull(val, NULL, 10);
+                if (opts.find == 0)
+                    goto usage;
+                continue;
+            }
+            if ((val = long_opt(arg, "min-path"))) {
+                if (percent_opt(val, &opts.min_path) != 0)
+                    goto usage;
+                continue;
+            }
+            if ((val = long_opt(arg, "max-dead"))) {
+                if (percent_opt(val, &opts.max_dead) != 0)
+                    goto usage;
+                continue;
+            }
+            if ((val = long_opt(arg, "play"))) {
+                opts.play = val;
+                continue;
+            }
+            if ((val = long_opt(arg, "decode"))) {
+                opts.decode = val;
+                continue;
+            }
+            if ((val = long_opt(arg, "memfd"))) {
+                opts.memfd = val;
+                continue;
+            }
+            if ((val = long_opt(arg, "out"))) {
+                opts.out = val;
+                continue;
+            }
+            if ((val = long_opt(arg, "frames"))) {
+                opts.frames = (u32)strtoul(val, NULL, 10);
+                continue;
+            }
+            if ((val = long_opt(arg, "trace"))) {
+                if (trace_open(val) != 0)
+                    return 1;
+                continue;
+            }
+
+            if (*arg)
+                goto usage;
+
+            /* End of arguments.    */
             argv[k] = argv[0];
             argc = argc - k;
             argv = argv + k;
@@ -143,10 +444,41 @@ int main(int argc, char *argv[]) {
             puts("  -w<n>    - Set maze width (columns)");
             puts("  -h<n>    - Set maze height (rows)");
             puts("  -r<s>    - Set random seed (string)");
-            puts("  -o<fmt>  - Set output format (svg|ascii, default ASCII)");
-            puts("  -c<n>    - Set corridor width (pixels, SVG output)");
+            puts("  -r<a>..<b> - Batch: generate mazes of seeds a to b");
+            puts("  -o<fmt>  - Set output format (svg|svgdash|svgfill|ascii|"
+                 "braille|html|record|gif|arc|qoi, default ASCII)");
+            puts("  -c<n>    - Set corridor width (pixels, SVG output, "
+                 "cell size of images)");
             puts("  -p<n>    - Set pen radius (pixels, SVG output)");
             puts("  -f<s>    - Set foreground colour (CSS Color3 string)");
+            puts("  -n<n>    - Batch: generate n mazes from consecutive seeds");
+            puts("  -j<n>    - Number of worker threads (default 0, one "
+                 "per CPU)");
+            puts("  -d<dir>  - Batch: output directory (default .)");
+            puts("  -T       - Log representation choice to stderr");
+            puts("  --max-mem=<n>[KMG] - Limit memory used for the maze");
+            puts("  --topology=<t>     - Cell shape (rect|tri, default rect)");
+            puts("  --jobs=<file>      - Batch: run the mazes listed in file");
+            puts("  --shard=<i>/<n>    - Batch: run slice i (from 0) of n");
+            puts("  --nest=<w>x<h>     - Expand each cell into a w x h maze");
+            puts("  --trace=<file>     - Write a Chrome trace timeline");
+            puts("  --find=<k>         - Print the first k seeds meeting the "
+                 "limits below, from -r");
+            puts("  --min-path=<p>     - Find: least solution length "
+                 "(percent of cells)");
+            puts("  --max-dead=<p>     - Find: most dead ends (percent of "
+                 "cells)");
+            puts("  --play=<file>      - Draw a recording as animated SVG");
+            puts("  --frames=<n>       - Animation frames (default 100)");
+            puts("  --decode=<file>    - Draw every maze in an archive");
+            puts("  --memfd=<socket>   - Send output as a sealed memfd over "
+                 "a Unix socket (path or fd:<n>)");
+            puts("  --out=<file>       - Write output to file, in parallel");
+            puts("  --solve[=<x>,<y>:<x>,<y>]");
+            puts("                     - Draw the solution between two "
+                 "cells (default corners)");
+            puts("  --solver=<s>       - Solver (auto|astar|fill|bfs, "
+                 "default auto)");
             return 1;
         }
 
@@ -154,21 +486,116 @@ int main(int argc, char *argv[]) {
             goto usage;
     }
 
-    prng_srand(opts.random_seed);
+    if (opts.columns == 0 || opts.rows == 0)
+        goto usage;
+
+    if (opts.shards && opts.batch_count == 0 && opts.jobs == NULL)
+        goto usage;
+
+    if ((opts.memfd || opts.out) && (opts.batch_count || opts.jobs))
+        goto usage;
+
+    if (opts.memfd && opts.out)
+        goto usage;
+
+    if (opts.find && (opts.jobs || opts.shards || opts.memfd || opts.out ||
+                      opts.max_mem))
+        goto usage;
+
+    struct svg_opts svg_opts = {
+        .pen_radius = opts.pen_radius,
+        .corridor_width = opts.corridor_width,
+        .fg_color = opts.fg_color,
+    };
+
+    if (opts.play) {
+        FILE *in = fopen(opts.play, "rb");
+        if (in == NULL) {
+            fprintf(stderr, "Unable to open %s\n", opts.play);
+            return 1;
+        }
+
+        struct maze_record rec;
+        u32 columns, rows;
+        int err = record_read(in, &rec, &columns, &rows);
+        fclose(in);
+        if (err)
+            return 1;
+
+        i64 n = record_draw_smil(stdout, &rec, columns, rows, &svg_opts,
+                                 opts.frames);
+        maze_record_free(&rec);
+        return (n < 0) ? 1 : 0;
+    }
+
+    struct maze_job job = {
+        .seed = opts.random_seed,
+        .columns = opts.columns,
+        .rows = opts.rows,
+        .nest_columns = opts.nest_columns,
+        .nest_rows = opts.nest_rows,
+        .max_mem = opts.max_mem,
+        .topology = opts.topology,
+        .output = opts.output,
+        .svg = &svg_opts,
+        .frames = opts.frames,
+        .verbose = opts.verbose,
+        .solve = opts.solve ? &opts.ends : NULL,
+        .solver = opts.solver,
+    };
 
-    grid *maze = maze_generate(opts.columns, opts.rows);
+    pool_start(opts.threads);
+
+    if (opts.decode) {
+        int err = main_decode(opts.decode, opts.output, &svg_opts);
+        pool_stop();
+        return err ? 1 : 0;
+    }
 
-    if (0 == strcmp("svg", opts.output)) {
-        struct svg_opts svg_opts = {
-            .pen_radius = opts.pen_radius,
-            .corridor_width = opts.corridor_width,
-            .fg_color = opts.fg_color,
+    if (opts.memfd) {
+        int err = share_run(&job, opts.memfd);
+        pool_stop();
+        return err ? 1 : 0;
+    }
+
+    if (opts.out) {
+        int err = outfile_run(&job, opts.out);
+        pool_stop();
+        return err ? 1 : 0;
+    }
+
+    if (opts.find) {
+        /* A seed range, or count, bounds the seeds tried. */
+        struct find_opts find = {
+            .count = opts.find,
+            .tries = opts.batch_count,
+            .min_path = opts.min_path,
+            .max_dead = opts.max_dead,
         };
-        maze_draw_svg(maze, &svg_opts);
-    } else {
-        maze_draw_ascii(maze, "#", " ");
+        int err = find_run(&job, &find, stdout);
+        pool_stop();
+        return err ? 1 : 0;
     }
 
-    grid_free(maze);
-    return 0;
+    if (opts.batch_count > 0 || opts.jobs) {
+        struct batch_opts batch = {
+            .count = opts.batch_count,
+            .dir = opts.batch_dir,
+            .jobs = opts.jobs,
+            .shard = opts.shard,
+            .shards = opts.shards,
+        };
+        int err = batch_run(&job, &batch);
+        pool_stop();
+        return err ? 1 : 0;
+    }
+
+    i64 n = job_run(&job, stdout, NULL);
+
+    TRACE_BEGIN("flush");
+    fflush(stdout);
+    TRACE_END("flush");
+
+    pool_stop();
+    return (n < 0) ? 1 : 0;
 }
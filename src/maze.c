@@ -2,7 +2,11 @@
 #include "maze.h"
 
 #include "prng.h"
+#include "trace.h"
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 
 typedef struct {
@@ -10,151 +14,502 @@ typedef struct {
 } pt;
 
 
+/** Offsets of the four walk directions, indexed by direction. */
+static const pt directions[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+/**
+ * Walk stack frame: the low nibble marks which directions have been tried
+ * from this cell, bits 4-5 hold the direction taken to reach it.
+ */
+#define FRAME_TRIED 0x0F
+#define FRAME_DIR(f) (((f) >> 4) & 3)
+
+/**
+ * Steps are gathered 32 at a time in a word before being stored to the
+ * record, whose steps were allocated up front.
+ */
+struct record_acc {
+    u64 bits;
+    u32 count;
+};
+
+static void maze_record_flush(struct maze_record *rec, struct record_acc *acc) {
+    u8 *p = rec->steps + (rec->moves >> 2);
+    for (u32 k = 0; k < (acc->count + 3) / 4; ++k) {
+        p[k] = (u8)(acc->bits >> (8 * k));
+    }
+    rec->moves += acc->count;
+    acc->bits = 0;
+    acc->count = 0;
+}
+
+static inline void maze_record_push(struct maze_record *rec,
+                                    struct record_acc *acc, u32 dir) {
+    acc->bits |= (u64)dir << (2 * acc->count);
+    if (++acc->count == 32) {
+        maze_record_flush(rec, acc);
+    }
+}
+
+void maze_record_free(struct maze_record *rec) {
+    free(rec->steps);
+    rec->steps = NULL;
+    rec->moves = rec->cap = 0;
+}
+
 /**
- * Recursively wander around the grid at random, stopping at any cells that is
- * already visited or out of bounds.
+ * Wander around the grid at random, depth first, stopping at any cell that
+ * is already visited or out of bounds.
  *
- * For any newly visited cell whose coordinate is given by `curr`: Mark it
- * visited, then carve out the corresponding space from `maze_grid` as well as
- * the cell connecting it to the space we came from, given by `prev`.
+ * For any newly visited cell: carve out the corresponding space from
+ * `maze_grid` as well as the cell connecting it to the space we came from.
+ * A cell is visited once its space has been carved, so no separate walk grid
+ * is needed, and the path back to the start is kept on an explicit stack of
+ * one byte per step rather than the call stack.
  *
- * The walk finishes once all cells are visited.
+ * The walk is confined to the `columns` x `rows` corridors from `origin`,
+ * and finishes once all of them are visited. Random numbers are drawn in
+ * the same order as the original recursive walk so seeds keep producing the
+ * same mazes. Each carve and backtrack is appended to `rec` if it is not
+ * NULL.
  */
-static void maze_visit(grid *walk_grid, grid *maze_grid, pt curr, pt prev) {
-    /* OOB check, base case */
-    if (curr.x < 0 || curr.x >= (int)walk_grid->columns ||
-        curr.y < 0 || curr.y >= (int)walk_grid->rows) {
-        return;
-    }
-    /* Already visited, base case */
-    if (walk_grid->cells[curr.y * walk_grid->columns + curr.x]) {
-        return;
+static int maze_walk(grid *maze_grid, pt origin, int columns, int rows,
+                     pt curr, struct maze_record *rec) {
+
+    size_t cap = 4096;
+    size_t depth = 0;
+    u8 *stack = malloc(cap);
+    if (stack == NULL) {
+        fprintf(stderr, "Unable to allocate memory for maze walk\n");
+        return -1;
     }
 
-    /* Mark seen */
-    walk_grid->cells[curr.y * walk_grid->columns + curr.x] = 1;
+    grid_set(maze_grid, curr.x * 2 + 1, curr.y * 2 + 1, 0);
+    stack[depth++] = 0;
+    struct record_acc acc = {0, 0};
 
-    /* Carve from this cell to where we just came from in the maze */
-    pt dir = {prev.x - curr.x, prev.y - curr.y};
-    pt maze_curr = {curr.x * 2 + 1, curr.y * 2 + 1};
-    pt maze_prev = {maze_curr.x + dir.x, maze_curr.y + dir.y};
-    maze_grid->cells[maze_curr.y * maze_grid->columns + maze_curr.x] = 0;
-    maze_grid->cells[maze_prev.y * maze_grid->columns + maze_prev.x] = 0;
+    while (depth > 0) {
+        u8 *frame = &stack[depth - 1];
+
+        if ((*frame & FRAME_TRIED) == FRAME_TRIED) {
+            /* Exhausted this cell, step back the way we came */
+            if (--depth > 0) {
+                pt dir = directions[FRAME_DIR(*frame)];
+                curr.x -= dir.x;
+                curr.y -= dir.y;
+                if (rec) {
+                    maze_record_push(rec, &acc, FRAME_DIR(*frame) ^ 1);
+                }
+            }
+            continue;
+        }
 
-    /* Now do the same for neighbouring cells in a shuffled order */
-    pt directions[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
-    u8 done[4] = {0, 0, 0, 0};
-    while (!done[0] || !done[1] || !done[2] || !done[3]) {
+        /* Try the neighbouring cells in a shuffled order */
         u32 r = prng_nextuint() % 4; /* @fixme Not great shuffle */
-        while (done[r]) {
+        while (*frame & (1u << r)) {
             r = prng_nextuint() % 4;
         }
-        done[r] = 1;
-        dir = directions[r];
-        maze_visit(walk_grid, maze_grid, (pt){curr.x + dir.x, curr.y + dir.y}, curr);
+        *frame |= (u8)(1u << r);
+
+        pt dir = directions[r];
+        pt next = {curr.x + dir.x, curr.y + dir.y};
+        /* OOB or already visited */
+        if (next.x < origin.x || next.x >= origin.x + columns ||
+            next.y < origin.y || next.y >= origin.y + rows ||
+            !grid_get(maze_grid, next.x * 2 + 1, next.y * 2 + 1)) {
+            continue;
+        }
+
+        /* Carve the new cell and the wall back to where we came from */
+        grid_set(maze_grid, next.x * 2 + 1, next.y * 2 + 1, 0);
+        grid_set(maze_grid, curr.x * 2 + 1 + dir.x, curr.y * 2 + 1 + dir.y, 0);
+
+        if (depth == cap) {
+            u8 *grown = realloc(stack, cap * 2);
+            if (grown == NULL) {
+                fprintf(stderr, "Unable to allocate memory for maze walk\n");
+                free(stack);
+                return -1;
+            }
+            stack = grown;
+            cap *= 2;
+        }
+        stack[depth++] = (u8)(r << 4);
+        curr = next;
+        if (rec) {
+            maze_record_push(rec, &acc, r);
+        }
     }
+
+    if (rec) {
+        maze_record_flush(rec, &acc);
+    }
+    free(stack);
+    return 0;
 }
 
 grid* maze_generate(u32 columns, u32 rows) {
-    /* Initialize two boolean grids: One to track the progress of the random
-     * walk, the other to carve out the paths the walker has visited level
-     * walls behind.
+    return maze_generate_kind(columns, rows, GRID_BYTES, NULL);
+}
+
+grid* maze_generate_kind(u32 columns, u32 rows, enum grid_kind kind,
+                         struct maze_record *record) {
+    /* Initialize a boolean grid with every wall in place, the walker will
+     * carve out the paths as it visits them.
      */
-    grid *walk_grid = grid_alloc_init(columns, rows, 0);
-    grid *maze_grid = grid_alloc_init(columns * 2 + 1, rows * 2 + 1, 1);
+    grid *maze_grid = grid_alloc_kind(columns * 2 + 1, rows * 2 + 1, 1, kind);
+    if (maze_grid == NULL) {
+        return NULL;
+    }
 
     /* Start at a random point: */
     pt start = {prng_nextuint() % columns, prng_nextuint() % rows};
 
-    maze_visit(walk_grid, maze_grid, start, start);
+    if (record) {
+        /* Every cell but the first is carved once and backtracked once. */
+        record->start_x = (u32)start.x;
+        record->start_y = (u32)start.y;
+        record->moves = 0;
+        record->cap = ((u64)columns * rows * 2 + 3) / 4;
+        record->steps = malloc(record->cap);
+        if (record->steps == NULL) {
+            fprintf(stderr, "Unable to allocate memory for maze record\n");
+            grid_free(maze_grid);
+            return NULL;
+        }
+    }
+
+    pt origin = {0, 0};
+    if (maze_walk(maze_grid, origin, (int)columns, (int)rows,
+                  start, record) != 0) {
+        grid_free(maze_grid);
+        return NULL;
+    }
 
-    /* Done with the random walk. */
-    grid_free(walk_grid);
     return maze_grid;
 }
 
+int maze_carve(grid *maze_grid, u32 x, u32 y, u32 columns, u32 rows) {
+    pt origin = {(int)x, (int)y};
+    pt start;
+    start.x = (int)(x + prng_nextuint() % columns);
+    start.y = (int)(y + prng_nextuint() % rows);
+    return maze_walk(maze_grid, origin, (int)columns, (int)rows, start, NULL);
+}
+
 /**
- * Print maze as ASCII or UTF-8 characters to standard output.
+ * Print maze as ASCII or UTF-8 characters to `out`.
  */
-void maze_draw_ascii(grid *maze, const char *fg, const char *bg) {
-    for (u32 y = 0, y_ = maze->rows; y < y_; ++y) {
+u64 maze_draw_ascii(FILE *out, grid *maze, const char *fg, const char *bg) {
+    return maze_draw_ascii_band(out, maze, fg, bg, 0, 1);
+}
+
+u64 maze_draw_ascii_band(FILE *out, const grid *maze,
+                         const char *fg, const char *bg,
+                         u32 band, u32 bands) {
+    const u64 fg_len = strlen(fg);
+    const u64 bg_len = strlen(bg);
+    const u32 y0 = (u32)((u64)maze->rows * band / bands);
+    const u32 y1 = (u32)((u64)maze->rows * (band + 1) / bands);
+    u64 n = 0;
+
+    for (u32 y = y0; y < y1; ++y) {
         for (u32 x = 0, x_ = maze->columns; x < x_; ++x) {
-            printf("%s", (maze->cells[y * x_ + x]) ? fg : bg);
+            if (grid_get(maze, x, y)) {
+                fputs(fg, out);
+                n += fg_len;
+            } else {
+                fputs(bg, out);
+                n += bg_len;
+            }
         }
-        printf("\n");
+        fputc('\n', out);
+        ++n;
     }
+    return n;
+}
+
+u64 maze_size_ascii_band(const grid *maze, const char *fg, const char *bg,
+                         u32 band, u32 bands) {
+    const u64 fg_len = strlen(fg);
+    const u64 bg_len = strlen(bg);
+    const u32 y0 = (u32)((u64)maze->rows * band / bands);
+    const u32 y1 = (u32)((u64)maze->rows * (band + 1) / bands);
+    const u64 cells = (u64)(y1 - y0) * maze->columns;
+
+    /* Only walls need counting when the glyphs differ in length. */
+    u64 walls = 0;
+    for (u32 y = y0; fg_len != bg_len && y < y1; ++y) {
+        for (u32 x = 0, x_ = maze->columns; x < x_; ++x) {
+            walls += grid_get(maze, x, y);
+        }
+    }
+    return walls * fg_len + (cells - walls) * bg_len + (y1 - y0);
+}
+
+/* Decimal digits of `v`. */
+static u64 svg_digits(u32 v) {
+    u64 n = 1;
+    while (v >= 10) {
+        v /= 10;
+        ++n;
+    }
+    return n;
 }
 
 /**
- * Render maze as an SVG document.
+ * Write a wall line to `out`, or if `out` is NULL only return the number of
+ * bytes it would take.
  */
-void maze_draw_svg(grid *maze, struct svg_opts *opts) {
-    /* Calculate total width and height: */
-    u32 total_width = (maze->columns / 2) * opts->corridor_width;
-    u32 total_height = (maze->rows / 2) * opts->corridor_width;
-
-    /* SVG Preamble */
-    printf("<?xml version='1.0' standalone='no'?>\n");
-    printf("<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 %u %u'>",
-           total_width, total_height);
-    printf("<g stroke-linecap='round' stroke-width='%u' stroke='%s'>",
-           opts->pen_radius, opts->fg_color);
-
-    u32 ypos = 0;
-    for (u32 y = 0, y_ = maze->rows; y < y_; y += 2) {
-        u32 x1 = 0;
-        u32 x2 = 0;
-        for (u32 x = 0, x_ = maze->columns; x < x_;) {
-            while (x < x_ && maze->cells[y * x_ + x]) {
-                if (x % 2 != 0) {
-                    x2 += opts->corridor_width;
-                }
-                ++x;
-            }
+static u64 svg_line(FILE *out, u32 x1, u32 y1, u32 x2, u32 y2) {
+    if (out == NULL) {
+        return sizeof("<line x1='' y1='' x2='' y2=''/>") - 1 +
+               svg_digits(x1) + svg_digits(y1) +
+               svg_digits(x2) + svg_digits(y2);
+    }
+    return (u64)fprintf(out, "<line x1='%u' y1='%u' x2='%u' y2='%u'/>",
+                        x1, y1, x2, y2);
+}
 
-            if (x2 > x1) {
-                printf("<line x1='%u' y1='%u' x2='%u' y2='%u'/>",
-                       x1, ypos, x2, ypos);
-            }
+/* Like fprintf, only counting bytes if `out` is NULL. */
+static u64 svg_printf(FILE *out, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = out ? vfprintf(out, fmt, ap) : vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    return (n > 0) ? (u64)n : 0;
+}
 
-            while (x < x_ && !maze->cells[y * x_ + x]) {
-                x2 += opts->corridor_width;
-                x1 = x2;
-                ++x;
-            }
+/**
+ * Runs of wall along one wall row or column, at `pos` across it. Plain
+ * output draws a line per run. Dashed output draws one line from the start
+ * of the first run to the end of the last, whose stroke-dasharray holds the
+ * lengths of the runs and the gaps between them. The first run is held back
+ * until it is known whether a second follows.
+ */
+struct svg_runs {
+    FILE *out;
+    u8 dash;
+    u8 vertical;
+    u32 pos;
+
+    u32 count;
+    u32 first;
+    u32 first_end;
+    u32 last_end;
+    u64 n;
+};
+
+static u64 svg_run_line(const struct svg_runs *r, u32 from, u32 to) {
+    return r->vertical ? svg_line(r->out, r->pos, from, r->pos, to)
+                       : svg_line(r->out, from, r->pos, to, r->pos);
+}
+
+static void svg_run(struct svg_runs *r, u32 from, u32 to) {
+    if (!r->dash) {
+        r->n += svg_run_line(r, from, to);
+        return;
+    }
+
+    if (r->count == 0) {
+        r->first = from;
+        r->first_end = to;
+    } else {
+        if (r->count == 1) {
+            r->n += svg_printf(r->out, "<line stroke-dasharray='%u",
+                               r->first_end - r->first);
         }
+        r->n += svg_printf(r->out, " %u %u", from - r->last_end, to - from);
+    }
+    r->last_end = to;
+    ++r->count;
+}
 
-        ypos += opts->corridor_width;
+static u64 svg_runs_end(struct svg_runs *r) {
+    if (r->dash && r->count == 1) {
+        r->n += svg_run_line(r, r->first, r->first_end);
+    } else if (r->dash && r->count > 1) {
+        const u32 x1 = r->vertical ? r->pos : r->first;
+        const u32 y1 = r->vertical ? r->first : r->pos;
+        const u32 x2 = r->vertical ? r->pos : r->last_end;
+        const u32 y2 = r->vertical ? r->last_end : r->pos;
+        r->n += svg_printf(r->out, "' x1='%u' y1='%u' x2='%u' y2='%u'/>",
+                           x1, y1, x2, y2);
     }
+    return r->n;
+}
 
-    u32 xpos = 0;
-    for (u32 x = 0, x_ = maze->columns; x < x_; x += 2) {
-        u32 y1 = 0;
-        u32 y2 = 0;
-        for (u32 y = 0, y_ = maze->rows; y < y_;) {
-            while (y < y_ && maze->cells[y * x_ + x]) {
-                if (y % 2 != 0) {
-                    y2 += opts->corridor_width;
-                }
-                ++y;
+/* Lines along the walls of grid row `y`. */
+static u64 svg_wall_row(FILE *out, const grid *maze,
+                        const struct svg_opts *opts, u32 y) {
+    struct svg_runs runs = {
+        .out = out,
+        .dash = opts->dash,
+        .pos = (y / 2) * opts->corridor_width,
+    };
+    u32 x1 = 0;
+    u32 x2 = 0;
+    for (u32 x = 0, x_ = maze->columns; x < x_;) {
+        while (x < x_ && grid_get(maze, x, y)) {
+            if (x % 2 != 0) {
+                x2 += opts->corridor_width;
             }
+            ++x;
+        }
 
-            if (y2 > y1) {
-                printf("<line x1='%u' y1='%u' x2='%u' y2='%u'/>",
-                       xpos, y1, xpos, y2);
-            }
+        if (x2 > x1) {
+            svg_run(&runs, x1, x2);
+        }
 
-            while (y < y_ && !maze->cells[y * x_ + x]) {
+        while (x < x_ && !grid_get(maze, x, y)) {
+            x2 += opts->corridor_width;
+            x1 = x2;
+            ++x;
+        }
+    }
+    return svg_runs_end(&runs);
+}
+
+/* Lines along the walls of grid column `x`. */
+static u64 svg_wall_column(FILE *out, const grid *maze,
+                           const struct svg_opts *opts, u32 x) {
+    struct svg_runs runs = {
+        .out = out,
+        .dash = opts->dash,
+        .vertical = 1,
+        .pos = (x / 2) * opts->corridor_width,
+    };
+    u32 y1 = 0;
+    u32 y2 = 0;
+    for (u32 y = 0, y_ = maze->rows; y < y_;) {
+        while (y < y_ && grid_get(maze, x, y)) {
+            if (y % 2 != 0) {
                 y2 += opts->corridor_width;
-                y1 = y2;
-                ++y;
             }
+            ++y;
+        }
+
+        if (y2 > y1) {
+            svg_run(&runs, y1, y2);
         }
 
-        xpos += opts->corridor_width;
+        while (y < y_ && !grid_get(maze, x, y)) {
+            y2 += opts->corridor_width;
+            y1 = y2;
+            ++y;
+        }
     }
+    return svg_runs_end(&runs);
+}
+
+/**
+ * Lines through the middle of the runs of solution cells along grid row or
+ * column `pos`, in half pixel units so odd corridor widths stay exact. A
+ * grid cell's middle is then its index times the corridor width.
+ */
+static u64 svg_solution_runs(FILE *out, const struct svg_opts *opts,
+                             u8 vertical, u32 pos) {
+    const grid *solution = opts->solution;
+    const u32 cw = opts->corridor_width;
+    struct svg_runs runs = {
+        .out = out,
+        .dash = opts->dash,
+        .vertical = vertical,
+        .pos = pos * cw,
+    };
+    const u32 end = vertical ? solution->rows : solution->columns;
+    for (u32 k = 0; k < end; ++k) {
+        const u32 first = k;
+        while (k < end && (vertical ? grid_get(solution, pos, k)
+                                    : grid_get(solution, k, pos))) {
+            ++k;
+        }
+        if (k > first + 1) {
+            svg_run(&runs, first * cw, (k - 1) * cw);
+        }
+    }
+    return svg_runs_end(&runs);
+}
+
+/* The solution of `opts`, over the walls. */
+static u64 svg_solution(FILE *out, const struct svg_opts *opts) {
+    const grid *solution = opts->solution;
+    u64 n = svg_printf(out,
+                       "<g stroke-linecap='round' stroke-width='%u' "
+                       "stroke='" SVG_SOLUTION_COLOR "' "
+                       "transform='scale(.5)'>", 2 * opts->pen_radius);
+    for (u32 y = 1; y < solution->rows; y += 2) {
+        n += svg_solution_runs(out, opts, 0, y);
+    }
+    for (u32 x = 1; x < solution->columns; x += 2) {
+        n += svg_solution_runs(out, opts, 1, x);
+    }
+    return n + svg_printf(out, "</g>");
+}
+
+/**
+ * Render maze as an SVG document to `out`.
+ */
+u64 maze_draw_svg(FILE *out, grid *maze, struct svg_opts *opts) {
+    return maze_draw_svg_band(out, maze, opts, 0, 1);
+}
+
+/**
+ * The document is the preamble, a run of lines for each wall row and then
+ * for each wall column, and the close. Bands split the runs evenly.
+ */
+u64 maze_draw_svg_band(FILE *out, const grid *maze,
+                       const struct svg_opts *opts, u32 band, u32 bands) {
+    const u32 wall_rows = maze->rows / 2 + 1;
+    const u32 wall_columns = maze->columns / 2 + 1;
+    const u64 runs = (u64)wall_rows + wall_columns;
+    const u64 r0 = runs * band / bands;
+    const u64 r1 = runs * (band + 1) / bands;
+    u64 n = 0;
+
+    if (band == 0) {
+        /* Calculate total width and height: */
+        u32 total_width = (maze->columns / 2) * opts->corridor_width;
+        u32 total_height = (maze->rows / 2) * opts->corridor_width;
+
+        /* SVG Preamble */
+        n += svg_printf(out, "<?xml version='1.0' standalone='no'?>\n");
+        n += svg_printf(out,
+                        "<svg xmlns='http://www.w3.org/2000/svg' "
+                        "viewBox='0 0 %u %u'>", total_width, total_height);
+        n += svg_printf(out,
+                        "<g stroke-linecap='round' stroke-width='%u' "
+                        "stroke='%s'>", opts->pen_radius, opts->fg_color);
+    }
+
+    if (r0 < wall_rows) {
+        TRACE_BEGIN("horizontal");
+        for (u64 r = r0; r < r1 && r < wall_rows; ++r) {
+            n += svg_wall_row(out, maze, opts, (u32)r * 2);
+        }
+        TRACE_END("horizontal");
+    }
+
+    if (r1 > wall_rows) {
+        TRACE_BEGIN("vertical");
+        for (u64 r = (r0 > wall_rows) ? r0 : wall_rows; r < r1; ++r) {
+            n += svg_wall_column(out, maze, opts, (u32)(r - wall_rows) * 2);
+        }
+        TRACE_END("vertical");
+    }
+
+    if (band + 1 == bands) {
+        /* SVG Close */
+        n += svg_printf(out, "</g>");
+        if (opts->solution) {
+            n += svg_solution(out, opts);
+        }
+        n += svg_printf(out, "</svg>\n");
+    }
+    return n;
+}
 
-    /* SVG Close */
-    printf("</g>");
-    printf("</svg>\n");
+u64 maze_size_svg_band(const grid *maze, const struct svg_opts *opts,
+                       u32 band, u32 bands) {
+    return maze_draw_svg_band(NULL, maze, opts, band, bands);
 }
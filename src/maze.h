@@ -4,6 +4,9 @@
 #ifndef MAZE_H
 #define MAZE_H
 
+#include <limits.h>
+#include <stdio.h>
+
 #include "types.h"
 #include "grid.h"
 
@@ -12,8 +15,46 @@ struct svg_opts {
     u32 corridor_width;
 
     const char *fg_color;
+
+    /** Draw each wall row and column as one dashed line. */
+    u8 dash;
+
+    /** Solution cells (see solve.h) to draw over the walls, or NULL. */
+    const grid *solution;
 };
 
+/**
+ * Most corridors along a side of a maze, so that grid coordinates, twice
+ * the corridor plus one, fit in an int.
+ */
+#define MAZE_MAX_SIDE ((u32)(INT_MAX / 2))
+
+/** Stroke colour of solutions drawn over SVG output. */
+#define SVG_SOLUTION_COLOR "red"
+
+/**
+ * Record of the random walk that carved a maze: the starting cell, then
+ * each step as a 2 bit walk direction (east, west, south, north), packed
+ * four to a byte, lowest bits first. A step back towards the previous cell
+ * is a backtrack, any other step carves a new cell.
+ */
+struct maze_record {
+    u32 start_x;
+    u32 start_y;
+
+    u64 moves;
+    u8 *steps;
+    u64 cap;
+};
+
+/** Walk direction of step `k` of a record. */
+static inline u32 maze_record_step(const struct maze_record *rec, u64 k) {
+    return (rec->steps[k >> 2] >> ((k & 3) * 2)) & 3;
+}
+
+/** Free the steps of a record. */
+void maze_record_free(struct maze_record *rec);
+
 /**
  * Initiallize a grid that can hold a generated maze of `columns` x `rows`
  * corridors. (N.B: That is columns x rows walkable space; including walls the
@@ -27,18 +68,87 @@ struct svg_opts {
 grid* maze_generate(u32 columns, u32 rows);
 
 /**
- * Draw grid to the console as ASCII (or UTF-8 if the terminal will render it)
+ * As `maze_generate`, but store the maze grid using the storage given by
+ * `kind`. Generation needs at most `columns` x `rows` bytes of working
+ * memory on top of the grid itself.
+ *
+ * If `record` is not NULL the walk is recorded into it, taking a further
+ * `columns` x `rows` / 2 bytes. Free it with `maze_record_free`.
+ *
+ * @return Grid* Pointer to a grid containing the generated maze, or NULL if
+ *               memory could not be allocated.
+ */
+grid* maze_generate_kind(u32 columns, u32 rows, enum grid_kind kind,
+                         struct maze_record *record);
+
+/**
+ * Carve a maze into the window of `columns` x `rows` corridors of
+ * `maze_grid` whose top left corridor is `x`, `y`, walking from a random
+ * cell of the window with the calling thread's PRNG. The window's corridors
+ * must all be walls beforehand. Nothing outside the window is read or
+ * written, so disjoint windows of a byte grid can be carved concurrently.
+ *
+ * @return 0 on success, -1 if memory could not be allocated.
+ */
+int maze_carve(grid *maze_grid, u32 x, u32 y, u32 columns, u32 rows);
+
+/**
+ * Draw grid to `out` as ASCII (or UTF-8 if the terminal will render it)
  * characters. Wall cells will be rendered as the `fg` glyph, spaces as the
  * `bg` glyph.
+ *
+ * @return u64 Number of bytes written.
+ */
+u64 maze_draw_ascii(FILE *out, grid* maze, const char *fg, const char *bg);
+
+/**
+ * Draw band `band` of `bands` of the rows `maze_draw_ascii` would draw.
+ * Bands split the rows evenly and can be drawn concurrently.
+ *
+ * @return u64 Number of bytes written.
+ */
+u64 maze_draw_ascii_band(FILE *out, const grid *maze,
+                         const char *fg, const char *bg,
+                         u32 band, u32 bands);
+
+/**
+ * Number of bytes `maze_draw_ascii_band` would write, without drawing.
  */
-void maze_draw_ascii(grid* maze, const char *fg, const char *bg);
+u64 maze_size_ascii_band(const grid *maze, const char *fg, const char *bg,
+                         u32 band, u32 bands);
 
 /**
- * Draw grid to the console as an SVG document. Walls will be draw as a set of
+ * Draw grid to `out` as an SVG document. Walls will be draw as a set of
  * lines using `opts.pen_radius` as the stroke width in pixels and
  * `opts.fg_color` as the stroke colour. Spacing between maze lines is given
  * by `opts.corridor_width` in pixels.
+ *
+ * With `opts.dash` set each wall row and column is a single line, its runs
+ * of wall drawn by a stroke-dasharray, so the document has one element per
+ * row and column rather than per run.
+ *
+ * With `opts.solution` set, the solution is drawn last through the middle of
+ * its corridors, a line for each of its straight runs.
+ *
+ * @return u64 Number of bytes written.
+ */
+u64 maze_draw_svg(FILE *out, grid* maze, struct svg_opts *opts);
+
+/**
+ * Draw band `band` of `bands` of the document `maze_draw_svg` would draw.
+ * The bands written in order make up the whole document, so they can be
+ * drawn concurrently into separate buffers and joined.
+ *
+ * @return u64 Number of bytes written.
+ */
+u64 maze_draw_svg_band(FILE *out, const grid *maze,
+                       const struct svg_opts *opts, u32 band, u32 bands);
+
+/**
+ * Number of bytes `maze_draw_svg_band` would write, counted from the runs of
+ * wall and the digits of their coordinates without formatting them.
  */
-void maze_draw_svg(grid* maze, struct svg_opts *opts);
+u64 maze_size_svg_band(const grid *maze, const struct svg_opts *opts,
+                       u32 band, u32 bands);
 
 #endif /* MAZE_H */
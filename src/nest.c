@@ -0,0 +1,113 @@
+/** @brief Nested mazes implementation */
+#include "nest.h"
+
+#include "maze.h"
+#include "pool.h"
+#include "prng.h"
+#include "trace.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct nest {
+    grid *maze;
+    u32 columns;
+    u32 sub_columns;
+    u32 sub_rows;
+    u64 seed;
+
+    atomic_uint failed;
+};
+
+/* Seed of sub-maze `k`, spread so that neighbouring seeds are unrelated. */
+static u64 nest_seed(u64 seed, u64 k) {
+    u64 z = seed + (k + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static void nest_carve(u64 begin, u64 end, void *arg) {
+    struct nest *n = arg;
+
+    for (u64 k = begin; k < end; ++k) {
+        const u32 x = (u32)(k % n->columns);
+        const u32 y = (u32)(k / n->columns);
+
+        prng_srand(nest_seed(n->seed, k));
+        if (maze_carve(n->maze, x * n->sub_columns, y * n->sub_rows,
+                       n->sub_columns, n->sub_rows) != 0) {
+            atomic_fetch_add(&n->failed, 1);
+        }
+    }
+}
+
+/* Open the borders between sub-mazes where the coarse maze has passages,
+ * half way along each border. */
+static void nest_join(grid *maze, const grid *coarse,
+                      u32 sub_columns, u32 sub_rows) {
+    const u32 columns = coarse->columns / 2;
+    const u32 rows = coarse->rows / 2;
+
+    for (u32 y = 0; y < rows; ++y) {
+        for (u32 x = 0; x < columns; ++x) {
+            if (x + 1 < columns && !grid_get(coarse, 2 * x + 2, 2 * y + 1)) {
+                grid_set(maze, 2 * (x + 1) * sub_columns,
+                         2 * (y * sub_rows + sub_rows / 2) + 1, 0);
+            }
+            if (y + 1 < rows && !grid_get(coarse, 2 * x + 1, 2 * y + 2)) {
+                grid_set(maze, 2 * (x * sub_columns + sub_columns / 2) + 1,
+                         2 * (y + 1) * sub_rows, 0);
+            }
+        }
+    }
+}
+
+grid* nest_generate(u32 columns, u32 rows, u32 sub_columns, u32 sub_rows,
+                    enum grid_kind kind) {
+    const u64 width = (u64)columns * sub_columns * 2 + 1;
+    const u64 height = (u64)rows * sub_rows * 2 + 1;
+    if (width > UINT32_MAX || height > UINT32_MAX) {
+        fprintf(stderr, "Unable to nest %ux%u mazes in a %ux%u maze\n",
+                sub_columns, sub_rows, columns, rows);
+        return NULL;
+    }
+
+    TRACE_BEGIN("coarse");
+    grid *coarse = maze_generate(columns, rows);
+    TRACE_END("coarse");
+    if (coarse == NULL) {
+        return NULL;
+    }
+
+    /* Drawn before the grid is allocated, which for a large grid waits on
+     * the pool and may run other mazes on this thread meanwhile. */
+    const u64 seed = prng_nextuint();
+
+    grid *maze = grid_alloc_kind((u32)width, (u32)height, 1, kind);
+    if (maze == NULL) {
+        grid_free(coarse);
+        return NULL;
+    }
+    nest_join(maze, coarse, sub_columns, sub_rows);
+    grid_free(coarse);
+
+    struct nest n = {
+        .maze = maze,
+        .columns = columns,
+        .sub_columns = sub_columns,
+        .sub_rows = sub_rows,
+        .seed = seed,
+    };
+    atomic_init(&n.failed, 0);
+
+    TRACE_BEGIN_ARG("sub-mazes", (u64)columns * rows);
+    pool_for(0, (u64)columns * rows, 1, nest_carve, &n);
+    TRACE_END("sub-mazes");
+
+    if (atomic_load(&n.failed)) {
+        grid_free(maze);
+        return NULL;
+    }
+    return maze;
+}
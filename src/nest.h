@@ -0,0 +1,29 @@
+/**
+ * @brief Nested mazes
+ *
+ * A maze of mazes: every cell of a coarse maze is expanded into a sub-maze
+ * of its own, and neighbouring sub-mazes are joined through a fixed opening
+ * wherever the coarse maze has a passage. Since each sub-maze and the coarse
+ * maze are perfect, so is the whole.
+ */
+#ifndef NEST_H
+#define NEST_H
+
+#include "types.h"
+#include "grid.h"
+
+/**
+ * Generate a maze of `columns` x `rows` sub-mazes, each of `sub_columns` x
+ * `sub_rows` corridors, into a grid of storage `kind`, which must not be
+ * GRID_BITS. Only the finest level is stored in the grid.
+ *
+ * The coarse maze, and the seed of each sub-maze, come from the calling
+ * thread's PRNG. Sub-mazes are carved concurrently on the thread pool, and
+ * the maze does not depend on the number of threads.
+ *
+ * @return grid* Pointer to the maze, or NULL on failure.
+ */
+grid* nest_generate(u32 columns, u32 rows, u32 sub_columns, u32 sub_rows,
+                    enum grid_kind kind);
+
+#endif /* NEST_H */
@@ -0,0 +1,179 @@
+/** @brief Parallel positional file output implementation */
+#define _GNU_SOURCE /* fallocate, fopencookie */
+#include "outfile.h"
+
+#include "grid.h"
+#include "pool.h"
+#include "trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Bands per pool thread, so threads finishing early can steal more. */
+#define OUTFILE_BANDS_PER_THREAD 4
+/* Stdio buffer of each band, the size of each pwrite. */
+#define OUTFILE_BUFFER (1u << 20)
+
+struct outfile {
+    const struct maze_job *job;
+    const grid *maze;
+    int fd;
+    u32 bands;
+    /* Offset of each band in the file, then the file size. */
+    u64 *offsets;
+
+    atomic_uint failed;
+};
+
+/* The part of the file a band writes to. */
+struct outfile_span {
+    int fd;
+    u64 pos;
+    u64 end;
+};
+
+static ssize_t outfile_pwrite(void *cookie, const char *buf, size_t size) {
+    struct outfile_span *s = cookie;
+    if (size > s->end - s->pos) {
+        return -1;
+    }
+    size_t done = 0;
+    while (done < size) {
+        ssize_t w = pwrite(s->fd, buf + done, size - done,
+                           (off_t)(s->pos + done));
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            return -1;
+        }
+        done += (size_t)w;
+    }
+    s->pos += size;
+    return (ssize_t)size;
+}
+
+static void outfile_size(u64 begin, u64 end, void *arg) {
+    struct outfile *o = arg;
+    for (u64 band = begin; band < end; ++band) {
+        o->offsets[band + 1] = job_size_band(o->job, o->maze, (u32)band,
+                                             o->bands);
+    }
+}
+
+static void outfile_draw(u64 begin, u64 end, void *arg) {
+    struct outfile *o = arg;
+    cookie_io_functions_t io = { .write = outfile_pwrite };
+
+    for (u64 band = begin; band < end; ++band) {
+        struct outfile_span span = {
+            .fd = o->fd,
+            .pos = o->offsets[band],
+            .end = o->offsets[band + 1],
+        };
+        char *buffer = malloc(OUTFILE_BUFFER);
+        FILE *out = buffer ? fopencookie(&span, "w", io) : NULL;
+        if (out == NULL) {
+            free(buffer);
+            atomic_fetch_add(&o->failed, 1);
+            continue;
+        }
+        setvbuf(out, buffer, _IOFBF, OUTFILE_BUFFER);
+
+        TRACE_BEGIN_ARG("band", band);
+        i64 n = job_draw_band(o->job, o->maze, out, (u32)band, o->bands);
+        TRACE_END("band");
+        if (fclose(out) != 0 || n < 0 || span.pos != span.end ||
+            (u64)n != span.end - o->offsets[band]) {
+            atomic_fetch_add(&o->failed, 1);
+        }
+        free(buffer);
+    }
+}
+
+/* Allocate the file's blocks up front, and set its final size. */
+static int outfile_reserve(int fd, u64 size) {
+#ifdef __linux__
+    /* Not every file system can, the blocks then come as bands land. */
+    if (size && fallocate(fd, 0, 0, (off_t)size) == 0) {
+        return 0;
+    }
+#endif
+    return ftruncate(fd, (off_t)size);
+}
+
+/* Output that cannot be split into bands is written as it comes. */
+static int outfile_stream(const struct maze_job *job, const char *path) {
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return -1;
+    }
+    i64 n = job_run(job, out, NULL);
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Unable to write %s\n", path);
+        return -1;
+    }
+    return (n < 0) ? -1 : 0;
+}
+
+int outfile_run(const struct maze_job *job, const char *path) {
+    grid *maze = NULL;
+    int split = job_generate(job, &maze, NULL);
+    if (split <= 0) {
+        return (split == 0) ? outfile_stream(job, path) : -1;
+    }
+
+    struct outfile o = {
+        .job = job,
+        .maze = maze,
+        .fd = -1,
+        .bands = pool_threads() * OUTFILE_BANDS_PER_THREAD,
+    };
+    atomic_init(&o.failed, 0);
+    o.offsets = calloc(o.bands + 1, sizeof(u64));
+    if (o.offsets == NULL) {
+        fprintf(stderr, "Unable to allocate memory for output bands\n");
+        grid_free(maze);
+        return -1;
+    }
+
+    TRACE_BEGIN("size");
+    pool_for(0, o.bands, 1, outfile_size, &o);
+    TRACE_END("size");
+    for (u32 band = 0; band < o.bands; ++band) {
+        o.offsets[band + 1] += o.offsets[band];
+    }
+
+    int err = 0;
+    o.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (o.fd < 0) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        err = -1;
+    } else if (outfile_reserve(o.fd, o.offsets[o.bands]) != 0) {
+        fprintf(stderr, "Unable to allocate %llu bytes for %s\n",
+                (unsigned long long)o.offsets[o.bands], path);
+        err = -1;
+    }
+
+    if (!err) {
+        TRACE_BEGIN("render");
+        pool_for(0, o.bands, 1, outfile_draw, &o);
+        TRACE_END("render");
+        if (atomic_load(&o.failed)) {
+            fprintf(stderr, "Unable to write %s\n", path);
+            err = -1;
+        }
+    }
+    if (o.fd >= 0 && close(o.fd) != 0 && !err) {
+        fprintf(stderr, "Unable to write %s\n", path);
+        err = -1;
+    }
+
+    free(o.offsets);
+    grid_free(maze);
+    return err;
+}
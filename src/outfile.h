@@ -0,0 +1,24 @@
+/**
+ * @brief Parallel positional file output
+ *
+ * Write a job's output to a file with every pool thread writing at once:
+ * the size of each band of the output is worked out first, the file is
+ * allocated at its final size, and each band is then drawn and written at
+ * its own offset with pwrite.
+ */
+#ifndef OUTFILE_H
+#define OUTFILE_H
+
+#include "types.h"
+#include "job.h"
+
+/**
+ * Run `job` into the file at `path`, replacing it. Svg and ascii output of
+ * mazes held in memory is written in parallel, other output as `job_run`
+ * writes it.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int outfile_run(const struct maze_job *job, const char *path);
+
+#endif /* OUTFILE_H */
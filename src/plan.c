@@ -0,0 +1,73 @@
+/** @brief Maze representation planning implementation */
+#include "plan.h"
+
+#include "stream.h"
+
+
+u64 plan_memory(u32 columns, u32 rows, enum plan_repr repr) {
+    /* Depth first walk keeps a byte per step on its stack. */
+    const u64 walk = (u64)columns * rows;
+    const u32 gw = columns * 2 + 1;
+    const u32 gh = rows * 2 + 1;
+
+    switch (repr) {
+    case PLAN_BYTES:
+        return grid_cell_bytes(gw, gh, GRID_BYTES) + walk;
+    case PLAN_BITS:
+        return grid_cell_bytes(gw, gh, GRID_BITS) + walk;
+    case PLAN_STREAM:
+        return maze_stream_bytes(columns);
+    default:
+        /* Mapped cells live in the page cache and can be written back. */
+        return walk;
+    }
+}
+
+enum plan_repr plan_choose(u32 columns, u32 rows, u64 budget, int streamable,
+                           const u64 *extra) {
+    static const enum plan_repr order[] = {
+        PLAN_BYTES, PLAN_BITS, PLAN_STREAM, PLAN_MMAP
+    };
+
+    enum plan_repr smallest = PLAN_MMAP;
+    u64 least = UINT64_MAX;
+    for (u32 k = 0; k < sizeof(order) / sizeof(order[0]); ++k) {
+        if (order[k] == PLAN_STREAM && !streamable) {
+            continue;
+        }
+        const u64 bytes = plan_memory(columns, rows, order[k]) +
+                          (extra ? extra[order[k]] : 0);
+        if (budget == 0 || bytes <= budget) {
+            return order[k];
+        }
+        if (bytes < least) {
+            smallest = order[k];
+            least = bytes;
+        }
+    }
+    return smallest;
+}
+
+enum grid_kind plan_grid_kind(enum plan_repr repr) {
+    switch (repr) {
+    case PLAN_BITS:
+        return GRID_BITS;
+    case PLAN_MMAP:
+        return GRID_MMAP;
+    default:
+        return GRID_BYTES;
+    }
+}
+
+const char* plan_repr_name(enum plan_repr repr) {
+    switch (repr) {
+    case PLAN_BITS:
+        return "bits";
+    case PLAN_STREAM:
+        return "stream";
+    case PLAN_MMAP:
+        return "mmap";
+    default:
+        return "bytes";
+    }
+}
@@ -0,0 +1,49 @@
+/**
+ * @brief Maze representation planning
+ *
+ * Pick how a maze is stored while it is generated and drawn, given the
+ * maze dimensions and a memory budget.
+ */
+#ifndef PLAN_H
+#define PLAN_H
+
+#include "types.h"
+#include "grid.h"
+
+/** Maze representations, fastest first. */
+enum plan_repr {
+    PLAN_BYTES,      /**< One byte per grid cell, in memory. */
+    PLAN_BITS,       /**< One bit per grid cell, in memory. */
+    PLAN_STREAM,     /**< Generated and drawn a row at a time. */
+    PLAN_MMAP,       /**< One byte per grid cell, in a mapped file. */
+};
+
+/** Number of representations. */
+#define PLAN_REPRS 4
+
+/**
+ * Estimate the peak memory in bytes needed to generate and draw a maze of
+ * `columns` x `rows` corridors using `repr`. Estimates are worst case, the
+ * walk stack of the grid representations is assumed to reach every cell.
+ */
+u64 plan_memory(u32 columns, u32 rows, enum plan_repr repr);
+
+/**
+ * Choose the fastest representation for a maze of `columns` x `rows`
+ * corridors whose estimated memory fits within `budget` bytes. A `budget` of
+ * 0 means unlimited. `streamable` is zero if the requested output cannot be
+ * produced a row at a time. If `extra` is not NULL, `extra[repr]` bytes are
+ * needed on top of the maze with each representation, as a solver needs.
+ *
+ * If nothing fits, the representation needing the least memory is returned.
+ */
+enum plan_repr plan_choose(u32 columns, u32 rows, u64 budget, int streamable,
+                           const u64 *extra);
+
+/** Grid storage used by a (non-streaming) representation. */
+enum grid_kind plan_grid_kind(enum plan_repr repr);
+
+/** Name of a representation, for diagnostics. */
+const char* plan_repr_name(enum plan_repr repr);
+
+#endif /* PLAN_H */
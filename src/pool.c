@@ -0,0 +1,467 @@
+/** @brief Work-stealing thread pool implementation */
+#define _GNU_SOURCE /* CPU affinity */
+#include "pool.h"
+
+#include "trace.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Initial capacity of each deque, doubled whenever it fills. */
+#define POOL_DEQUE_SIZE 256
+
+struct pool_task {
+    pool_fn fn;
+    void *arg;
+    struct pool_group *group;
+};
+
+struct pool_array {
+    struct pool_array *retired;
+    i64 size;
+    _Atomic(struct pool_task *) tasks[];
+};
+
+/**
+ * Chase-Lev deque, with the C11 orderings of Lê et al., "Correct and
+ * Efficient Work-Stealing for Weak Memory Models". Outgrown arrays may still
+ * be read by thieves, so they are kept until the pool stops.
+ */
+struct pool_deque {
+    atomic_llong top;
+    atomic_llong bottom;
+    _Atomic(struct pool_array *) array;
+    /* Keep each deque's indices on their own cache lines. */
+    char pad[64 - 2 * sizeof(atomic_llong) - sizeof(void *)];
+};
+
+/* Result of a steal that lost a race, worth retrying. */
+#define POOL_ABORT ((struct pool_task *)1)
+
+struct pool {
+    /* Workers asked for, started on the first task queued. */
+    u32 want;
+    u32 threads;
+    struct pool_deque *deques;
+    pthread_t *tids;
+    u32 started;
+    atomic_int stop;
+
+    /* Idle workers sleep until the epoch moves: a task was queued, a
+     * group finished or the pool is stopping. */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    atomic_ullong epoch;
+    atomic_uint sleepers;
+};
+
+static struct pool pool = {0};
+
+/* Worker index of the calling thread, -1 outside the pool. */
+static _Thread_local int pool_self = -1;
+static _Thread_local u32 pool_rand = 0;
+
+
+static struct pool_array* pool_array_new(i64 size) {
+    struct pool_array *a = malloc(sizeof(struct pool_array) +
+                                  sizeof(struct pool_task *) * (size_t)size);
+    if (a != NULL) {
+        a->retired = NULL;
+        a->size = size;
+    }
+    return a;
+}
+
+static int pool_push(struct pool_deque *dq, struct pool_task *task) {
+    i64 b = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+    i64 t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    struct pool_array *a = atomic_load_explicit(&dq->array,
+                                                memory_order_relaxed);
+
+    if (b - t > a->size - 1) {
+        struct pool_array *grown = pool_array_new(a->size * 2);
+        if (grown == NULL) {
+            return -1;
+        }
+        for (i64 k = t; k < b; ++k) {
+            atomic_store_explicit(
+                &grown->tasks[k % grown->size],
+                atomic_load_explicit(&a->tasks[k % a->size],
+                                     memory_order_relaxed),
+                memory_order_relaxed);
+        }
+        grown->retired = a;
+        atomic_store_explicit(&dq->array, grown, memory_order_release);
+        a = grown;
+    }
+
+    atomic_store_explicit(&a->tasks[b % a->size], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+    return 0;
+}
+
+static struct pool_task* pool_take(struct pool_deque *dq) {
+    i64 b = atomic_load_explicit(&dq->bottom, memory_order_relaxed) - 1;
+    struct pool_array *a = atomic_load_explicit(&dq->array,
+                                                memory_order_relaxed);
+    atomic_store_explicit(&dq->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    i64 t = atomic_load_explicit(&dq->top, memory_order_relaxed);
+
+    struct pool_task *task = NULL;
+    if (t <= b) {
+        task = atomic_load_explicit(&a->tasks[b % a->size],
+                                    memory_order_relaxed);
+        if (t == b) {
+            /* Last task, race any thieves for it. */
+            if (!atomic_compare_exchange_strong_explicit(
+                    &dq->top, &t, t + 1,
+                    memory_order_seq_cst, memory_order_relaxed)) {
+                task = NULL;
+            }
+            atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static struct pool_task* pool_steal_from(struct pool_deque *dq) {
+    i64 t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    i64 b = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return NULL;
+    }
+    struct pool_array *a = atomic_load_explicit(&dq->array,
+                                                memory_order_acquire);
+    struct pool_task *task = atomic_load_explicit(&a->tasks[t % a->size],
+                                                  memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(
+            &dq->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed)) {
+        return POOL_ABORT;
+    }
+    return task;
+}
+
+/* Steal from the other workers, starting at a random victim. */
+static struct pool_task* pool_steal(int self) {
+    const u32 n = pool.threads;
+    if (n < 2) {
+        return NULL;
+    }
+
+    u32 r = pool_rand;
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    pool_rand = r;
+
+    for (int retry = 1; retry;) {
+        retry = 0;
+        for (u32 k = 0; k < n; ++k) {
+            const u32 victim = (r + k) % n;
+            if ((int)victim == self) {
+                continue;
+            }
+            struct pool_task *task = pool_steal_from(&pool.deques[victim]);
+            if (task == POOL_ABORT) {
+                retry = 1;
+            } else if (task != NULL) {
+                return task;
+            }
+        }
+    }
+    return NULL;
+}
+
+static struct pool_task* pool_find(int self) {
+    struct pool_task *task = pool_take(&pool.deques[self]);
+    return task ? task : pool_steal(self);
+}
+
+static void pool_notify(void) {
+    atomic_fetch_add(&pool.epoch, 1);
+    if (atomic_load(&pool.sleepers) > 0) {
+        pthread_mutex_lock(&pool.lock);
+        pthread_cond_broadcast(&pool.wake);
+        pthread_mutex_unlock(&pool.lock);
+    }
+}
+
+/* Sleep unless the epoch has moved on from `epoch`, or `group` is done. */
+static void pool_sleep(u64 epoch, struct pool_group *group) {
+    pthread_mutex_lock(&pool.lock);
+    atomic_fetch_add(&pool.sleepers, 1);
+    while (atomic_load(&pool.epoch) == epoch && !atomic_load(&pool.stop) &&
+           !(group && atomic_load(&group->pending) == 0)) {
+        pthread_cond_wait(&pool.wake, &pool.lock);
+    }
+    atomic_fetch_sub(&pool.sleepers, 1);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+static void pool_run(struct pool_task *task) {
+    struct pool_group *group = task->group;
+    task->fn(task->arg);
+    free(task);
+    if (atomic_fetch_sub_explicit(&group->pending, 1,
+                                  memory_order_acq_rel) == 1) {
+        pool_notify();
+    }
+}
+
+#ifdef __linux__
+/* CPUs the process may run on, taken before any thread is pinned. */
+static cpu_set_t pool_allowed;
+static int pool_have_allowed = 0;
+#endif
+
+/* Pin the calling thread to the `k`'th CPU the process may run on. */
+static void pool_pin(u32 k) {
+#ifdef __linux__
+    const int n = pool_have_allowed ? CPU_COUNT(&pool_allowed) : 0;
+    if (n <= 0) {
+        return;
+    }
+    int want = (int)(k % (u32)n);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &pool_allowed) && want-- == 0) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+            return;
+        }
+    }
+#else
+    (void)k;
+#endif
+}
+
+static void* pool_worker(void *arg) {
+    const int self = (int)(size_t)arg;
+    pool_self = self;
+    pool_rand = 0x9E3779B9u * (u32)(self + 1);
+    pool_pin((u32)self);
+    trace_thread_name("pool worker");
+
+    while (!atomic_load(&pool.stop)) {
+        const u64 epoch = atomic_load(&pool.epoch);
+        struct pool_task *task = pool_find(self);
+        if (task != NULL) {
+            pool_run(task);
+        } else {
+            pool_sleep(epoch, NULL);
+        }
+    }
+    return NULL;
+}
+
+static u32 pool_cpus(void) {
+#ifdef __linux__
+    if (pool_have_allowed) {
+        return (u32)CPU_COUNT(&pool_allowed);
+    }
+#endif
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (u32)n : 1;
+}
+
+void pool_start(u32 threads) {
+#ifdef __linux__
+    pool_have_allowed =
+        (sched_getaffinity(0, sizeof(pool_allowed), &pool_allowed) == 0);
+#endif
+    pool.want = threads ? threads : pool_cpus();
+    pool_self = 0;
+}
+
+/* Start the workers, from worker 0 as it queues the pool's first task. */
+static int pool_launch(void) {
+    const u32 threads = pool.want;
+    pool.threads = threads;
+    pool.deques = calloc(threads, sizeof(struct pool_deque));
+    pool.tids = calloc(threads, sizeof(pthread_t));
+    if (pool.deques == NULL || pool.tids == NULL) {
+        fprintf(stderr, "Unable to allocate memory for %u threads\n", threads);
+        goto fail;
+    }
+    for (u32 k = 0; k < threads; ++k) {
+        struct pool_array *a = pool_array_new(POOL_DEQUE_SIZE);
+        if (a == NULL) {
+            fprintf(stderr, "Unable to allocate memory for %u threads\n",
+                    threads);
+            while (k-- > 0) {
+                free(atomic_load(&pool.deques[k].array));
+            }
+            goto fail;
+        }
+        atomic_init(&pool.deques[k].array, a);
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.wake, NULL);
+
+    pool_self = 0;
+    pool_rand = 0x9E3779B9u;
+    if (threads > 1) {
+        pool_pin(0);
+    }
+
+    /* Deques of workers that fail to start stay empty, and cost the
+     * others nothing but a look while stealing. */
+    u32 started = 1;
+    for (; started < threads; ++started) {
+        if (pthread_create(&pool.tids[started], NULL, pool_worker,
+                           (void *)(size_t)started) != 0) {
+            fprintf(stderr, "Unable to start pool thread %u\n", started);
+            break;
+        }
+    }
+    pool.started = started;
+    return (started < threads) ? -1 : 0;
+
+fail:
+    /* Run everything on the calling thread from now on. */
+    free(pool.deques);
+    free(pool.tids);
+    pool.deques = NULL;
+    pool.tids = NULL;
+    pool.threads = 0;
+    pool.want = 1;
+    return -1;
+}
+
+void pool_stop(void) {
+    pool.want = 0;
+    pool_self = -1;
+    if (pool.deques == NULL) {
+        return;
+    }
+
+    atomic_store(&pool.stop, 1);
+    pool_notify();
+    for (u32 k = 1; k < pool.started; ++k) {
+        pthread_join(pool.tids[k], NULL);
+    }
+
+    for (u32 k = 0; k < pool.threads; ++k) {
+        struct pool_array *a = atomic_load(&pool.deques[k].array);
+        while (a != NULL) {
+            struct pool_array *retired = a->retired;
+            free(a);
+            a = retired;
+        }
+    }
+    free(pool.deques);
+    free(pool.tids);
+    pool.deques = NULL;
+    pool.tids = NULL;
+    pool.threads = 0;
+    pool.started = 0;
+}
+
+u32 pool_threads(void) {
+    if (pool.started) {
+        return pool.started;
+    }
+    return pool.want ? pool.want : 1;
+}
+
+void pool_spawn(struct pool_group *group, pool_fn fn, void *arg) {
+    atomic_fetch_add(&group->pending, 1);
+
+    if (pool_self == 0 && pool.deques == NULL && pool.want > 1) {
+        /* Failing to start threads only costs speed, tasks still run. */
+        pool_launch();
+    }
+
+    struct pool_task *task = NULL;
+    if (pool_self >= 0 && pool.threads > 1) {
+        task = malloc(sizeof(struct pool_task));
+    }
+    if (task != NULL) {
+        task->fn = fn;
+        task->arg = arg;
+        task->group = group;
+        if (pool_push(&pool.deques[pool_self], task) == 0) {
+            pool_notify();
+            return;
+        }
+        free(task);
+    }
+
+    fn(arg);
+    atomic_fetch_sub(&group->pending, 1);
+}
+
+void pool_wait(struct pool_group *group) {
+    while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+        const u64 epoch = atomic_load(&pool.epoch);
+        struct pool_task *task = (pool_self >= 0 && pool.threads > 1)
+            ? pool_find(pool_self) : NULL;
+        if (task != NULL) {
+            pool_run(task);
+        } else if (atomic_load(&group->pending) > 0) {
+            pool_sleep(epoch, group);
+        }
+    }
+}
+
+/* --- Parallel for --- */
+
+struct pool_range {
+    u64 begin;
+    u64 end;
+    u64 grain;
+    pool_range_fn body;
+    void *arg;
+    struct pool_group *group;
+};
+
+static void pool_range_run(void *arg);
+
+/* Split halves off the top of the range for others, run the rest here. */
+static void pool_range_split(struct pool_range r) {
+    while (r.end - r.begin > r.grain) {
+        const u64 mid = r.begin + (r.end - r.begin) / 2;
+        struct pool_range *half = malloc(sizeof(struct pool_range));
+        if (half == NULL) {
+            break;
+        }
+        *half = r;
+        half->begin = mid;
+        pool_spawn(r.group, pool_range_run, half);
+        r.end = mid;
+    }
+    r.body(r.begin, r.end, r.arg);
+}
+
+static void pool_range_run(void *arg) {
+    struct pool_range r = *(struct pool_range *)arg;
+    free(arg);
+    pool_range_split(r);
+}
+
+void pool_for(u64 begin, u64 end, u64 grain, pool_range_fn body, void *arg) {
+    if (begin >= end) {
+        return;
+    }
+    struct pool_group group = {0};
+    struct pool_range r = {
+        .begin = begin,
+        .end = end,
+        .grain = grain ? grain : 1,
+        .body = body,
+        .arg = arg,
+        .group = &group,
+    };
+    pool_range_split(r);
+    pool_wait(&group);
+}
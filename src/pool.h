@@ -0,0 +1,68 @@
+/**
+ * @brief Work-stealing thread pool
+ *
+ * One pool serves every parallel path, so nested parallel work never runs
+ * more threads than the pool has. Each worker owns a Chase-Lev deque: it
+ * pushes and takes tasks at the bottom, while idle workers steal the oldest
+ * tasks from the top. The thread that starts the pool is worker 0 and
+ * works while it waits.
+ *
+ * Waiting threads run other tasks, possibly from unrelated work, so a task
+ * must not leave thread local state (the PRNG, say) it relies on across a
+ * wait, or must save and restore it around the wait.
+ */
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdatomic.h>
+
+#include "types.h"
+
+/** Tasks spawned together and waited for together. Zero initialise. */
+struct pool_group {
+    atomic_ullong pending;
+};
+
+typedef void (*pool_fn)(void *arg);
+
+/** Body of a parallel for loop over `begin` to `end` - 1. */
+typedef void (*pool_range_fn)(u64 begin, u64 end, void *arg);
+
+/**
+ * Set up a pool of `threads` workers, counting the calling thread, each
+ * pinned to its own CPU where the system allows. `threads` of 0 asks for one
+ * worker per available CPU.
+ *
+ * Workers are started, and pinned, when the calling thread queues the first
+ * task, so a process that never runs work on the pool stays on one thread
+ * and unpinned. If they cannot be started, the pool runs everything on the
+ * calling thread.
+ */
+void pool_start(u32 threads);
+
+/** Stop the pool's workers, once nothing is left to run. */
+void pool_stop(void);
+
+/**
+ * Number of workers, including the thread that started the pool, whether or
+ * not they have been started yet.
+ */
+u32 pool_threads(void);
+
+/**
+ * Queue `fn(arg)` to run on any worker as part of `group`. From a thread
+ * outside the pool, or if the task cannot be queued, it runs immediately.
+ */
+void pool_spawn(struct pool_group *group, pool_fn fn, void *arg);
+
+/** Run queued tasks until every task of `group` has finished. */
+void pool_wait(struct pool_group *group);
+
+/**
+ * Run `body` over `begin` to `end` - 1 in chunks of at most `grain`
+ * iterations, in parallel, and return once all have finished. Chunks are
+ * split off in halves so idle workers steal large ranges first.
+ */
+void pool_for(u64 begin, u64 end, u64 grain, pool_range_fn body, void *arg);
+
+#endif /* POOL_H */
@@ -32,7 +32,8 @@ static void pcg32_srand(struct pcg32_state *rng, u64 state, u64 inc) {
 
 /* --- PRNG API --- */
 
-static struct pcg32_state srng = {
+/* Each thread has its own generator, so threads seeded alike agree. */
+static _Thread_local struct pcg32_state srng = {
     .state = PCG32_INITSTATE,
     .inc = PCG32_INITINC
 };
@@ -44,3 +45,12 @@ void prng_srand(u64 seed) {
 u64 prng_nextuint(void) {
     return pcg32_nextuint(&srng);
 }
+
+void prng_save(struct prng_state *saved) {
+    saved->state = srng.state;
+    saved->inc = srng.inc;
+}
+
+void prng_restore(const struct prng_state *saved) {
+    pcg32_srand(&srng, saved->state, saved->inc);
+}
@@ -1,15 +1,22 @@
 /**
  * @brief Pseudo-random number generator
  *
- * Expose a simple interface for pseudorandom numbers.
+ * Expose a simple interface for pseudorandom numbers. Generator state is
+ * per thread.
  */
 #ifndef PRNG_H
 #define PRNG_H
 
 #include "types.h"
 
+/** Saved state of a thread's PRNG. */
+struct prng_state {
+    u64 state;
+    u64 inc;
+};
+
 /**
- * Seed an internal PRNG with a new initial seed.
+ * Seed the calling thread's PRNG with a new initial seed.
  */
 void prng_srand(u64 seed);
 
@@ -18,4 +25,13 @@ void prng_srand(u64 seed);
  */
 u64 prng_nextuint(void);
 
+/**
+ * Save the calling thread's PRNG state, to restore after running pool tasks
+ * that may reseed it.
+ */
+void prng_save(struct prng_state *saved);
+
+/** Resume the calling thread's PRNG from a state saved by prng_save(). */
+void prng_restore(const struct prng_state *saved);
+
 #endif /* PRNG_H */
@@ -0,0 +1,144 @@
+/** @brief QOI raster output implementation */
+#include "qoi.h"
+
+#include "trace.h"
+#include <string.h>
+
+/* Opcodes of the QOI specification. */
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xC0
+#define QOI_OP_RGB 0xFE
+#define QOI_RUN_MAX 62
+
+#define QOI_BUFFER 65536
+
+static const u8 qoi_wall[3] = {0x00, 0x00, 0x00};
+static const u8 qoi_space[3] = {0xFF, 0xFF, 0xFF};
+
+struct qoi {
+    FILE *out;
+    i64 bytes;
+    u32 len;
+    u8 buf[QOI_BUFFER];
+
+    /* Previous pixel, pixels seen by hash, and the pending run. */
+    u8 prev[3];
+    u8 index[64][4];
+    u64 run;
+};
+
+static void qoi_flush(struct qoi *q) {
+    fwrite(q->buf, 1, q->len, q->out);
+    q->bytes += q->len;
+    q->len = 0;
+}
+
+static inline void qoi_put(struct qoi *q, u8 byte) {
+    if (q->len == QOI_BUFFER) {
+        qoi_flush(q);
+    }
+    q->buf[q->len++] = byte;
+}
+
+static void qoi_put_be32(struct qoi *q, u32 v) {
+    qoi_put(q, (u8)(v >> 24));
+    qoi_put(q, (u8)(v >> 16));
+    qoi_put(q, (u8)(v >> 8));
+    qoi_put(q, (u8)v);
+}
+
+static void qoi_end_run(struct qoi *q) {
+    while (q->run > 0) {
+        u64 n = (q->run < QOI_RUN_MAX) ? q->run : QOI_RUN_MAX;
+        qoi_put(q, (u8)(QOI_OP_RUN | (n - 1)));
+        q->run -= n;
+    }
+}
+
+/* Code one pixel of a colour other than the previous one. */
+static void qoi_pixel(struct qoi *q, const u8 px[3]) {
+    const u32 hash = (px[0] * 3u + px[1] * 5u + px[2] * 7u + 255u * 11u) % 64;
+    if (memcmp(q->index[hash], px, 3) == 0 && q->index[hash][3] == 255) {
+        qoi_put(q, (u8)(QOI_OP_INDEX | hash));
+    } else {
+        memcpy(q->index[hash], px, 3);
+        q->index[hash][3] = 255;
+
+        const int dr = (int8_t)(px[0] - q->prev[0]);
+        const int dg = (int8_t)(px[1] - q->prev[1]);
+        const int db = (int8_t)(px[2] - q->prev[2]);
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 &&
+            db >= -2 && db <= 1) {
+            qoi_put(q, (u8)(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 |
+                            (db + 2)));
+        } else if (dg >= -32 && dg <= 31 && dr - dg >= -8 && dr - dg <= 7 &&
+                   db - dg >= -8 && db - dg <= 7) {
+            qoi_put(q, (u8)(QOI_OP_LUMA | (dg + 32)));
+            qoi_put(q, (u8)((dr - dg + 8) << 4 | (db - dg + 8)));
+        } else {
+            qoi_put(q, QOI_OP_RGB);
+            qoi_put(q, px[0]);
+            qoi_put(q, px[1]);
+            qoi_put(q, px[2]);
+        }
+    }
+    memcpy(q->prev, px, 3);
+}
+
+/* Code `count` pixels of colour `px`, as a pixel and a run. */
+static inline void qoi_span(struct qoi *q, const u8 px[3], u64 count) {
+    if (memcmp(q->prev, px, 3) != 0) {
+        qoi_end_run(q);
+        qoi_pixel(q, px);
+        --count;
+    }
+    q->run += count;
+}
+
+i64 qoi_draw(FILE *out, const grid *maze, u32 scale) {
+    const u64 width = (u64)maze->columns * scale;
+    const u64 height = (u64)maze->rows * scale;
+    if (scale == 0 || width > UINT32_MAX || height > UINT32_MAX) {
+        fprintf(stderr, "Unable to draw a %llux%llu pixel QOI image\n",
+                (unsigned long long)width, (unsigned long long)height);
+        return -1;
+    }
+
+    struct qoi q = { .out = out };
+
+    memcpy(q.buf, "qoif", 4);
+    q.len = 4;
+    qoi_put_be32(&q, (u32)width);
+    qoi_put_be32(&q, (u32)height);
+    qoi_put(&q, 3);     /* RGB */
+    qoi_put(&q, 0);     /* sRGB with linear alpha */
+
+    /* Runs carry on across scanlines, as pixels are coded in one stream. */
+    TRACE_BEGIN("qoi");
+    for (u32 y = 0; y < maze->rows; ++y) {
+        for (u32 line = 0; line < scale; ++line) {
+            u32 x = 0;
+            while (x < maze->columns) {
+                const u8 wall = grid_get(maze, x, y);
+                u32 end = x + 1;
+                while (end < maze->columns && grid_get(maze, end, y) == wall) {
+                    ++end;
+                }
+                qoi_span(&q, wall ? qoi_wall : qoi_space,
+                         (u64)(end - x) * scale);
+                x = end;
+            }
+        }
+    }
+    qoi_end_run(&q);
+    TRACE_END("qoi");
+
+    static const u8 qoi_end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    for (u32 k = 0; k < sizeof(qoi_end); ++k) {
+        qoi_put(&q, qoi_end[k]);
+    }
+    qoi_flush(&q);
+    return q.bytes;
+}
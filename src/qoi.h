@@ -0,0 +1,24 @@
+/**
+ * @brief QOI raster output
+ *
+ * Draw a maze grid as a QOI ("Quite OK Image") file, a lossless format
+ * whose run length and colour index opcodes suit the large flat areas of a
+ * maze, and which encodes far faster than deflate.
+ */
+#ifndef QOI_H
+#define QOI_H
+
+#include <stdio.h>
+
+#include "types.h"
+#include "grid.h"
+
+/**
+ * Draw `maze` to `out` as an RGB QOI image, every grid cell `scale` x
+ * `scale` pixels, walls black and corridors white.
+ *
+ * @return Number of bytes written, or -1 if the image would be too large.
+ */
+i64 qoi_draw(FILE *out, const grid *maze, u32 scale);
+
+#endif /* QOI_H */
@@ -0,0 +1,195 @@
+/** @brief Maze walk recordings implementation */
+#include "record.h"
+
+#include "codec.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_MAGIC "SVMR"
+#define RECORD_VERSION 1
+#define RECORD_HEADER 40
+
+/* Milliseconds per animation frame. */
+#define FRAME_MS 40
+
+
+i64 record_write(FILE *out, const struct maze_record *rec,
+                 u32 columns, u32 rows) {
+    struct walk_state ws;
+    if (walk_init(&ws, columns, rows, rec->start_x, rec->start_y) != 0) {
+        fprintf(stderr, "Unable to allocate memory for record encoder\n");
+        return -1;
+    }
+
+    struct rc_encoder rc;
+    rc_encoder_init(&rc);
+    int err = 0;
+    for (u64 k = 0; k < rec->moves && !err; ++k) {
+        err = walk_encode(&ws, &rc, maze_record_step(rec, k)) < 0;
+    }
+    err |= rc_encoder_finish(&rc) != 0;
+    walk_free(&ws);
+    if (err) {
+        fprintf(stderr, "Unable to allocate memory for record encoder\n");
+        rc_encoder_free(&rc);
+        return -1;
+    }
+
+    u8 header[RECORD_HEADER] = {0};
+    memcpy(header, RECORD_MAGIC, 4);
+    header[4] = RECORD_VERSION;
+    codec_put_le(header + 8, columns, 4);
+    codec_put_le(header + 12, rows, 4);
+    codec_put_le(header + 16, rec->start_x, 4);
+    codec_put_le(header + 20, rec->start_y, 4);
+    codec_put_le(header + 24, rec->moves, 8);
+    codec_put_le(header + 32, rc.len, 8);
+
+    fwrite(header, 1, RECORD_HEADER, out);
+    fwrite(rc.buf, 1, rc.len, out);
+    i64 n = RECORD_HEADER + (i64)rc.len;
+    rc_encoder_free(&rc);
+    return n;
+}
+
+int record_read(FILE *in, struct maze_record *rec, u32 *columns, u32 *rows) {
+    u8 header[RECORD_HEADER];
+    if (fread(header, 1, RECORD_HEADER, in) != RECORD_HEADER ||
+        memcmp(header, RECORD_MAGIC, 4) != 0 ||
+        header[4] != RECORD_VERSION) {
+        fprintf(stderr, "Not a maze recording\n");
+        return -1;
+    }
+
+    *columns = (u32)codec_get_le(header + 8, 4);
+    *rows = (u32)codec_get_le(header + 12, 4);
+    u32 x = (u32)codec_get_le(header + 16, 4);
+    u32 y = (u32)codec_get_le(header + 20, 4);
+    u64 moves = codec_get_le(header + 24, 8);
+    u64 len = codec_get_le(header + 32, 8);
+    if (x >= *columns || y >= *rows ||
+        moves > 2 * (u64)*columns * *rows) {
+        fprintf(stderr, "Corrupt maze recording\n");
+        return -1;
+    }
+
+    u8 *coded = malloc(len ? len : 1);
+    if (coded == NULL || fread(coded, 1, len, in) != len) {
+        fprintf(stderr, "Unable to read maze recording\n");
+        free(coded);
+        return -1;
+    }
+
+    memset(rec, 0, sizeof(*rec));
+    rec->start_x = x;
+    rec->start_y = y;
+    rec->cap = (moves + 3) / 4;
+    rec->steps = calloc(rec->cap ? rec->cap : 1, 1);
+
+    struct walk_state ws;
+    int err = (rec->steps == NULL) ||
+              walk_init(&ws, *columns, *rows, x, y) != 0;
+    if (!err) {
+        struct rc_decoder rc;
+        rc_decoder_init(&rc, coded, len);
+        for (u64 k = 0; k < moves; ++k) {
+            int move = walk_decode(&ws, &rc);
+            if (move < 0 || move == WALK_END) {
+                err = 1;
+                break;
+            }
+            rec->steps[k >> 2] |= (u8)(move << ((k & 3) * 2));
+        }
+        rec->moves = moves;
+        walk_free(&ws);
+    }
+    free(coded);
+
+    if (err) {
+        fprintf(stderr, "Unable to decode maze recording\n");
+        maze_record_free(rec);
+        return -1;
+    }
+    return 0;
+}
+
+i64 record_draw_smil(FILE *out, const struct maze_record *rec,
+                     u32 columns, u32 rows, const struct svg_opts *opts,
+                     u32 frames) {
+    struct walk_state ws;
+    if (walk_init(&ws, columns, rows, rec->start_x, rec->start_y) != 0) {
+        fprintf(stderr, "Unable to allocate memory for record player\n");
+        return -1;
+    }
+
+    /* Coordinates are doubled so cell centres land on whole numbers. */
+    const u32 cw = opts->corridor_width * 2;
+    const u32 width = (opts->corridor_width > opts->pen_radius)
+        ? (opts->corridor_width - opts->pen_radius) * 2 : 1;
+    i64 n = 0;
+
+    n += fprintf(out, "<?xml version='1.0' standalone='no'?>\n");
+    n += fprintf(out,
+                 "<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 %u %u'>",
+                 columns * cw, rows * cw);
+    n += fprintf(out, "<rect width='%u' height='%u' fill='%s'/>",
+                 columns * cw, rows * cw, opts->fg_color);
+    n += fprintf(out, "<g stroke='white' stroke-width='%u' "
+                 "stroke-linecap='square' fill='none'>", width);
+
+    /* The starting cell, as a zero length square capped line. */
+    n += fprintf(out, "<path d='M%u %uh0", ws.x * cw + cw / 2,
+                 ws.y * cw + cw / 2);
+    int open = 2;
+    u32 pen_x = ws.x;
+    u32 pen_y = ws.y;
+
+    frames = frames ? frames : 1;
+    u64 k = 0;
+    for (u32 f = 0; f < frames; ++f) {
+        const u64 end = rec->moves * (f + 1) / frames;
+        for (; k < end; ++k) {
+            const u32 x = ws.x;
+            const u32 y = ws.y;
+            int carved = walk_apply(&ws, maze_record_step(rec, k));
+            if (carved < 0) {
+                fprintf(stderr, "Unable to allocate memory for record "
+                        "player\n");
+                walk_free(&ws);
+                return -1;
+            }
+            if (!carved) {
+                continue;
+            }
+
+            /* Only the corridors carved during a frame go in its path. */
+            if (!open) {
+                n += fprintf(out, "<path visibility='hidden' d='");
+                open = 1;
+            }
+            if (x != pen_x || y != pen_y || open == 1) {
+                n += fprintf(out, "M%u %u", x * cw + cw / 2, y * cw + cw / 2);
+            }
+            n += fprintf(out, "L%u %u", ws.x * cw + cw / 2, ws.y * cw + cw / 2);
+            pen_x = ws.x;
+            pen_y = ws.y;
+            open = 2;
+        }
+
+        if (open) {
+            n += fprintf(out, "'>");
+            if (f > 0) {
+                n += fprintf(out, "<set attributeName='visibility' "
+                             "to='visible' begin='%u.%03us' fill='freeze'/>",
+                             f * FRAME_MS / 1000, f * FRAME_MS % 1000);
+            }
+            n += fprintf(out, "</path>");
+            open = 0;
+        }
+    }
+
+    n += fprintf(out, "</g>");
+    n += fprintf(out, "</svg>\n");
+    walk_free(&ws);
+    return n;
+}
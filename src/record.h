@@ -0,0 +1,48 @@
+/**
+ * @brief Maze walk recordings
+ *
+ * Store the walk that carved a maze as a compact, range coded file, and
+ * play recordings back as animated SVG.
+ *
+ * File layout, integers little endian:
+ *   "SVMR" version:u8 0:u8[3] columns:u32 rows:u32 start_x:u32 start_y:u32
+ *   moves:u64 length:u64 coded:u8[length]
+ */
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdio.h>
+
+#include "types.h"
+#include "maze.h"
+
+/**
+ * Encode the walk in `rec` of a `columns` x `rows` maze and write it to
+ * `out`.
+ *
+ * @return Number of bytes written, or -1 on failure.
+ */
+i64 record_write(FILE *out, const struct maze_record *rec,
+                 u32 columns, u32 rows);
+
+/**
+ * Read and decode a recording from `in` into `rec`, and the dimensions of
+ * its maze into `columns` and `rows`. Free `rec` with `maze_record_free`.
+ *
+ * @return 0 on success, -1 if the recording is invalid or unreadable.
+ */
+int record_read(FILE *in, struct maze_record *rec, u32 *columns, u32 *rows);
+
+/**
+ * Draw the walk in `rec` of a `columns` x `rows` maze to `out` as an SVG
+ * document animated with SMIL. Corridors are carved out of a solid
+ * `opts.fg_color` background over `frames` frames at 25 frames per second,
+ * each frame holding only the corridors carved during it.
+ *
+ * @return Number of bytes written, or -1 if memory could not be allocated.
+ */
+i64 record_draw_smil(FILE *out, const struct maze_record *rec,
+                     u32 columns, u32 rows, const struct svg_opts *opts,
+                     u32 frames);
+
+#endif /* RECORD_H */
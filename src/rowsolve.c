@@ -0,0 +1,502 @@
+/** @brief Row streaming maze solver implementation */
+#include "rowsolve.h"
+
+#include "stream.h"
+#include "tmpfile.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NO_SET UINT32_MAX
+
+/*
+ * A log entry holds bit arrays of a row's east and south walls, and of the
+ * first and last cells of each set within the rows so far, then for each
+ * end a cell in its set, or NO_SET before the end's row. Sets never cross,
+ * so the first and last bits give them back: reading along the row, a cell
+ * that is not first is in the innermost set still open.
+ *
+ * Once solved, an entry holds the row's cells, east and south walls on the
+ * solution in its first three bit arrays.
+ */
+enum { LOG_EAST, LOG_SOUTH, LOG_FIRST, LOG_LAST, LOG_ARRAYS };
+
+/* Working memory of the backward pass. */
+struct rowsolve_work {
+    /* Log entries of the row being solved and of the row above */
+    u8 *entry;
+    u8 *above;
+
+    /* Sets of the row above within the rows above, and of the row below
+     * within the rows below, and the count of each. */
+    u32 *top;
+    u32 *bottom;
+    u32 tops;
+    u32 bottoms;
+    /* A cell of the row below in each end's set, or NO_SET. */
+    u32 below[2];
+
+    /* Union-find over cells and sets */
+    u32 *parent;
+    u32 *remap;
+    u32 *joined;
+
+    /* Tree of top sets, cells and bottom sets, as adjacency lists */
+    u32 *edge_a;
+    u32 *edge_b;
+    u32 *offset;
+    u32 *adjacent;
+    u32 *from;
+    u32 *queue;
+};
+
+static inline u8* log_bits(const struct rowsolve *rs, u8 *entry, u32 k) {
+    return entry + (u64)k * ((rs->columns + 7) / 8);
+}
+
+static inline int bit_get(const u8 *bits, u32 x) {
+    return (bits[x >> 3] >> (x & 7)) & 1;
+}
+
+static inline void bit_set(u8 *bits, u32 x) {
+    bits[x >> 3] |= (u8)(1u << (x & 7));
+}
+
+static u32 set_find(u32 *parent, u32 s) {
+    while (parent[s] != s) {
+        parent[s] = parent[parent[s]];
+        s = parent[s];
+    }
+    return s;
+}
+
+static int log_write(const struct rowsolve *rs, const u8 *entry, u32 y) {
+    const off_t at = (off_t)((u64)y * rs->entry_bytes);
+    if (pwrite(rs->fd, entry, rs->entry_bytes, at) !=
+        (ssize_t)rs->entry_bytes) {
+        fprintf(stderr, "Unable to write solution log\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int log_read(const struct rowsolve *rs, u8 *entry, u32 y) {
+    const off_t at = (off_t)((u64)y * rs->entry_bytes);
+    if (pread(rs->fd, entry, rs->entry_bytes, at) !=
+        (ssize_t)rs->entry_bytes) {
+        fprintf(stderr, "Unable to read solution log\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Sets of a row from the first and last bits of its log entry. */
+static u32 log_sets(const struct rowsolve *rs, u8 *entry, u32 *sets,
+                    u32 *stack) {
+    const u8 *first = log_bits(rs, entry, LOG_FIRST);
+    const u8 *last = log_bits(rs, entry, LOG_LAST);
+    u32 count = 0;
+    u32 depth = 0;
+    for (u32 x = 0; x < rs->columns; ++x) {
+        const int f = bit_get(first, x);
+        const int l = bit_get(last, x);
+        sets[x] = f ? count++ : stack[depth - 1];
+        if (f && !l) {
+            stack[depth++] = sets[x];
+        } else if (!f && l) {
+            --depth;
+        }
+    }
+    return count;
+}
+
+static inline u32 log_end(const struct rowsolve *rs, const u8 *entry,
+                          u32 e) {
+    u32 x;
+    memcpy(&x, entry + LOG_ARRAYS * ((rs->columns + 7) / 8) +
+           e * sizeof(u32), sizeof(u32));
+    return x;
+}
+
+/* Stream the maze, logging each row. */
+static int rowsolve_forward(struct rowsolve *rs, const u32 ends[2][2],
+                            u8 *seen) {
+    struct maze_stream ms;
+    if (maze_stream_open(&ms, rs->columns, rs->rows) != 0) {
+        return -1;
+    }
+
+    const u32 columns = rs->columns;
+    u32 cell[2] = {NO_SET, NO_SET};
+    int err = 0;
+    TRACE_BEGIN("solve forward");
+    while (!err && maze_stream_next(&ms)) {
+        const u32 y = ms.y;
+        memset(rs->entry, 0, rs->entry_bytes);
+        u8 *east = log_bits(rs, rs->entry, LOG_EAST);
+        u8 *south = log_bits(rs, rs->entry, LOG_SOUTH);
+        u8 *first = log_bits(rs, rs->entry, LOG_FIRST);
+        u8 *last = log_bits(rs, rs->entry, LOG_LAST);
+
+        memset(seen, 0, columns);
+        for (u32 x = 0; x < columns; ++x) {
+            if (ms.east[x]) {
+                bit_set(east, x);
+            }
+            if (ms.south[x]) {
+                bit_set(south, x);
+            }
+            if (!seen[ms.sets[x]]) {
+                bit_set(first, x);
+                seen[ms.sets[x]] = 1;
+            }
+        }
+        memset(seen, 0, columns);
+        for (u32 x = columns; x-- > 0;) {
+            if (!seen[ms.sets[x]]) {
+                bit_set(last, x);
+                seen[ms.sets[x]] = 1;
+            }
+        }
+
+        /* Follow each end's set down through an open south wall. */
+        for (u32 e = 0; e < 2; ++e) {
+            if (y == ends[e][1]) {
+                cell[e] = ends[e][0];
+            }
+            memcpy(log_bits(rs, rs->entry, LOG_ARRAYS) + e * sizeof(u32),
+                   &cell[e], sizeof(u32));
+            if (cell[e] != NO_SET) {
+                const u32 set = ms.sets[cell[e]];
+                for (u32 x = 0; x < columns; ++x) {
+                    if (ms.sets[x] == set && !ms.south[x]) {
+                        cell[e] = x;
+                        break;
+                    }
+                }
+            }
+        }
+        err = log_write(rs, rs->entry, y);
+    }
+    TRACE_END("solve forward");
+
+    maze_stream_close(&ms);
+    return err;
+}
+
+/**
+ * Join the cells of the row in `w->entry` with the bottom sets through its
+ * open south walls and with each other through its open east walls, and
+ * number the new sets by first appearance into `w->joined`.
+ */
+static u32 rowsolve_join(const struct rowsolve *rs, struct rowsolve_work *w,
+                         int has_below) {
+    const u32 columns = rs->columns;
+    const u8 *east = log_bits(rs, w->entry, LOG_EAST);
+    const u8 *south = log_bits(rs, w->entry, LOG_SOUTH);
+    u32 *parent = w->parent;
+    for (u32 k = 0; k < columns + w->bottoms; ++k) {
+        parent[k] = k;
+        w->remap[k] = NO_SET;
+    }
+    for (u32 x = 0; x < columns; ++x) {
+        if (has_below && !bit_get(south, x)) {
+            parent[set_find(parent, x)] =
+                set_find(parent, columns + w->bottom[x]);
+        }
+        if (x + 1 < columns && !bit_get(east, x)) {
+            parent[set_find(parent, x)] = set_find(parent, x + 1);
+        }
+    }
+    u32 used = 0;
+    for (u32 x = 0; x < columns; ++x) {
+        const u32 s = set_find(parent, x);
+        if (w->remap[s] == NO_SET) {
+            w->remap[s] = used++;
+        }
+        w->joined[x] = w->remap[s];
+    }
+    return used;
+}
+
+static void tree_edge(struct rowsolve_work *w, u32 *edges, u32 a, u32 b) {
+    w->edge_a[*edges] = a;
+    w->edge_b[*edges] = b;
+    ++*edges;
+}
+
+/**
+ * Solve row `y`, whose entry is in `w->entry` and the entry above in
+ * `w->above`, into `solved`.
+ */
+static void rowsolve_row(const struct rowsolve *rs, struct rowsolve_work *w,
+                         u32 y, const u32 ends[2][2], u8 *solved) {
+    const u32 columns = rs->columns;
+    const u8 *east = log_bits(rs, w->entry, LOG_EAST);
+    const u8 *south = log_bits(rs, w->entry, LOG_SOUTH);
+    const u8 *above = log_bits(rs, w->above, LOG_SOUTH);
+    const int has_above = (y > 0);
+    const int has_below = (y + 1 < rs->rows);
+
+    /* Nodes: top sets, then cells, then bottom sets. */
+    const u32 cells = has_above ? w->tops : 0;
+    const u32 bottoms = cells + columns;
+    const u32 nodes = bottoms + (has_below ? w->bottoms : 0);
+
+    u32 edges = 0;
+    for (u32 x = 0; x < columns; ++x) {
+        if (has_above && !bit_get(above, x)) {
+            tree_edge(w, &edges, w->top[x], cells + x);
+        }
+        if (x + 1 < columns && !bit_get(east, x)) {
+            tree_edge(w, &edges, cells + x, cells + x + 1);
+        }
+        if (has_below && !bit_get(south, x)) {
+            tree_edge(w, &edges, cells + x, bottoms + w->bottom[x]);
+        }
+    }
+
+    memset(w->offset, 0, sizeof(u32) * (nodes + 1));
+    for (u32 k = 0; k < edges; ++k) {
+        ++w->offset[w->edge_a[k] + 1];
+        ++w->offset[w->edge_b[k] + 1];
+    }
+    for (u32 k = 0; k < nodes; ++k) {
+        w->offset[k + 1] += w->offset[k];
+    }
+    for (u32 k = 0; k < edges; ++k) {
+        w->adjacent[w->offset[w->edge_a[k]]++] = w->edge_b[k];
+        w->adjacent[w->offset[w->edge_b[k]]++] = w->edge_a[k];
+    }
+    for (u32 k = nodes; k-- > 0;) {
+        w->offset[k + 1] = w->offset[k];
+    }
+    w->offset[0] = 0;
+
+    /* The node holding each end. */
+    u32 end[2];
+    for (u32 e = 0; e < 2; ++e) {
+        if (ends[e][1] < y) {
+            end[e] = w->top[log_end(rs, w->above, e)];
+        } else if (ends[e][1] == y) {
+            end[e] = cells + ends[e][0];
+        } else {
+            end[e] = bottoms + w->bottom[w->below[e]];
+        }
+    }
+
+    /* Breadth first from one end to the other. */
+    for (u32 k = 0; k < nodes; ++k) {
+        w->from[k] = NO_SET;
+    }
+    u32 head = 0;
+    u32 tail = 0;
+    w->queue[tail++] = end[0];
+    w->from[end[0]] = end[0];
+    while (head < tail && w->from[end[1]] == NO_SET) {
+        const u32 a = w->queue[head++];
+        for (u32 k = w->offset[a]; k < w->offset[a + 1]; ++k) {
+            const u32 b = w->adjacent[k];
+            if (w->from[b] == NO_SET) {
+                w->from[b] = a;
+                w->queue[tail++] = b;
+            }
+        }
+    }
+
+    memset(solved, 0, rs->entry_bytes);
+    u8 *on = log_bits(rs, solved, LOG_EAST);
+    u8 *on_east = log_bits(rs, solved, LOG_SOUTH);
+    u8 *on_south = log_bits(rs, solved, LOG_FIRST);
+    for (u32 a = end[1]; w->from[a] != NO_SET; a = w->from[a]) {
+        const u32 b = w->from[a];
+        if (a >= cells && a < bottoms) {
+            bit_set(on, a - cells);
+        }
+        if (a == b) {
+            break;
+        }
+        if (a >= cells && a < bottoms && b >= cells && b < bottoms) {
+            bit_set(on_east, ((a < b) ? a : b) - cells);
+        } else if (a >= bottoms && b >= cells && b < bottoms) {
+            bit_set(on_south, b - cells);
+        } else if (b >= bottoms && a >= cells && a < bottoms) {
+            bit_set(on_south, a - cells);
+        }
+    }
+}
+
+/* Solve the log from the last row up, writing the solution over it. */
+static int rowsolve_backward(struct rowsolve *rs, struct rowsolve_work *w,
+                             const u32 ends[2][2]) {
+    const u32 columns = rs->columns;
+    int err = log_read(rs, w->entry, rs->rows - 1);
+    w->bottoms = 0;
+    w->below[0] = w->below[1] = NO_SET;
+
+    TRACE_BEGIN("solve backward");
+    for (u32 y = rs->rows; !err && y-- > 0;) {
+        if (y > 0) {
+            err = log_read(rs, w->above, y - 1);
+            w->tops = log_sets(rs, w->above, w->top, w->queue);
+        }
+        if (err) {
+            break;
+        }
+
+        rowsolve_row(rs, w, y, ends, rs->entry);
+
+        /* Sets of this row within the rows below, for the row above. */
+        const u32 joined = rowsolve_join(rs, w, y + 1 < rs->rows);
+        const u8 *south = log_bits(rs, w->entry, LOG_SOUTH);
+        for (u32 e = 0; e < 2; ++e) {
+            if (ends[e][1] == y) {
+                w->below[e] = ends[e][0];
+            } else if (ends[e][1] > y) {
+                const u32 set = w->bottom[w->below[e]];
+                for (u32 x = 0; x < columns; ++x) {
+                    if (!bit_get(south, x) && w->bottom[x] == set) {
+                        w->below[e] = x;
+                        break;
+                    }
+                }
+            }
+        }
+        memcpy(w->bottom, w->joined, sizeof(u32) * columns);
+        w->bottoms = joined;
+
+        err = log_write(rs, rs->entry, y);
+        u8 *t = w->entry;
+        w->entry = w->above;
+        w->above = t;
+    }
+    TRACE_END("solve backward");
+    return err;
+}
+
+static void rowsolve_work_free(struct rowsolve_work *w) {
+    free(w->entry);
+    free(w->above);
+    free(w->top);
+    free(w->bottom);
+    free(w->parent);
+    free(w->remap);
+    free(w->joined);
+    free(w->edge_a);
+    free(w->edge_b);
+    free(w->offset);
+    free(w->adjacent);
+    free(w->from);
+    free(w->queue);
+}
+
+u64 rowsolve_bytes(u32 columns) {
+    /* Three log entries, the row's overlay and 28 u32 per column of work. */
+    const u64 entry = LOG_ARRAYS * (((u64)columns + 7) / 8) +
+                      2 * sizeof(u32);
+    return 3 * entry + 3 * (u64)columns + sizeof(u32) * (28 * (u64)columns
+                                                         + 1);
+}
+
+int rowsolve_open(struct rowsolve *rs, u32 columns, u32 rows,
+                  const struct solve_ends *ends) {
+    memset(rs, 0, sizeof(*rs));
+    rs->columns = columns;
+    rs->rows = rows;
+    rs->y = NO_SET;
+    rs->entry_bytes = LOG_ARRAYS * (((u64)columns + 7) / 8) +
+                      2 * sizeof(u32);
+    rs->fd = -1;
+
+    if (ends->from_x >= columns || ends->to_x >= columns ||
+        ends->from_y >= rows || ends->to_y >= rows) {
+        fprintf(stderr, "Unable to solve between cells outside the maze\n");
+        return -1;
+    }
+    const u32 end[2][2] = {
+        {ends->from_x, ends->from_y},
+        {ends->to_x, ends->to_y},
+    };
+
+    const u64 n = columns;
+    struct rowsolve_work w = {
+        .entry = malloc(rs->entry_bytes),
+        .above = malloc(rs->entry_bytes),
+        .top = malloc(sizeof(u32) * n),
+        .bottom = malloc(sizeof(u32) * n),
+        .parent = malloc(sizeof(u32) * 2 * n),
+        .remap = malloc(sizeof(u32) * 2 * n),
+        .joined = malloc(sizeof(u32) * n),
+        .edge_a = malloc(sizeof(u32) * 3 * n),
+        .edge_b = malloc(sizeof(u32) * 3 * n),
+        .offset = malloc(sizeof(u32) * (3 * n + 1)),
+        .adjacent = malloc(sizeof(u32) * 6 * n),
+        .from = malloc(sizeof(u32) * 3 * n),
+        .queue = malloc(sizeof(u32) * 3 * n),
+    };
+    rs->entry = malloc(rs->entry_bytes);
+    rs->cells = malloc(columns);
+    rs->east = malloc(columns);
+    rs->south = malloc(columns);
+    int err = 0;
+    if (!w.entry || !w.above || !w.top || !w.bottom || !w.parent ||
+        !w.remap || !w.joined || !w.edge_a || !w.edge_b || !w.offset ||
+        !w.adjacent || !w.from || !w.queue || !rs->entry || !rs->cells ||
+        !rs->east || !rs->south) {
+        fprintf(stderr, "Unable to allocate memory for %u column solver\n",
+                columns);
+        err = -1;
+    }
+
+    if (!err) {
+        rs->fd = tmp_fd("solution log");
+        err = (rs->fd < 0) ? -1 : 0;
+    }
+    if (!err) {
+        err = rowsolve_forward(rs, end, rs->cells);
+    }
+    if (!err) {
+        err = rowsolve_backward(rs, &w, end);
+    }
+
+    rowsolve_work_free(&w);
+    if (err) {
+        rowsolve_close(rs);
+    }
+    return err;
+}
+
+int rowsolve_next(struct rowsolve *rs) {
+    const u32 y = rs->y + 1;
+    if (y >= rs->rows) {
+        return 0;
+    }
+    if (log_read(rs, rs->entry, y) != 0) {
+        return -1;
+    }
+    rs->y = y;
+
+    const u8 *on = log_bits(rs, rs->entry, LOG_EAST);
+    const u8 *on_east = log_bits(rs, rs->entry, LOG_SOUTH);
+    const u8 *on_south = log_bits(rs, rs->entry, LOG_FIRST);
+    for (u32 x = 0; x < rs->columns; ++x) {
+        rs->cells[x] = (u8)bit_get(on, x);
+        rs->east[x] = (u8)bit_get(on_east, x);
+        rs->south[x] = (u8)bit_get(on_south, x);
+    }
+    return 1;
+}
+
+void rowsolve_close(struct rowsolve *rs) {
+    if (rs->fd >= 0) {
+        close(rs->fd);
+    }
+    free(rs->entry);
+    free(rs->cells);
+    free(rs->east);
+    free(rs->south);
+    rs->fd = -1;
+    rs->entry = rs->cells = rs->east = rs->south = NULL;
+}
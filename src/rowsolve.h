@@ -0,0 +1,68 @@
+/**
+ * @brief Row streaming maze solver
+ *
+ * Solve a maze streamed a row at a time (see stream.h) with memory
+ * proportional to its width. A first pass streams the maze, logging each
+ * row's walls and the connected sets of its cells within the rows above
+ * to a temporary file. The log is then read back from the last row up,
+ * tracking the sets of each row's cells within the rows below. Above and
+ * below sets, joined by a row's own cells, form a small tree in which the
+ * path between the ends gives the row's share of the solution. Each row's
+ * share is written back over its log entry, so the solution can be read
+ * row by row while the maze is streamed a second time.
+ */
+#ifndef ROWSOLVE_H
+#define ROWSOLVE_H
+
+#include "types.h"
+#include "solve.h"
+
+struct rowsolve {
+    u32 columns;
+    u32 rows;
+    /** Index of the row most recently read by `rowsolve_next`. */
+    u32 y;
+
+    /** Cells of the current row on the solution. */
+    u8 *cells;
+    /** The solution passes through the east wall of each cell. */
+    u8 *east;
+    /** The solution passes through the south wall of each cell. */
+    u8 *south;
+
+    /* Log file and one entry of it */
+    int fd;
+    u64 entry_bytes;
+    u8 *entry;
+};
+
+/**
+ * Bytes of memory `rowsolve_open` and `rowsolve_next` use to solve a maze
+ * `columns` corridors wide, on top of streaming it.
+ */
+u64 rowsolve_bytes(u32 columns);
+
+/**
+ * Stream a maze of `columns` x `rows` corridors with the calling thread's
+ * PRNG and solve it between the corridor cells `ends`. The log takes half
+ * a byte per cell in a temporary file in $TMPDIR, or /tmp. Reseed the PRNG
+ * as it was to stream the same maze again alongside `rowsolve_next`.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int rowsolve_open(struct rowsolve *rs, u32 columns, u32 rows,
+                  const struct solve_ends *ends);
+
+/**
+ * Read the solution of the next row into `rs->cells`, `rs->east` and
+ * `rs->south`.
+ *
+ * @return 1 if a row was read, 0 once all rows have been read, or -1 if
+ *         the log could not be read.
+ */
+int rowsolve_next(struct rowsolve *rs);
+
+/** Free the memory and log of a solver. */
+void rowsolve_close(struct rowsolve *rs);
+
+#endif /* ROWSOLVE_H */
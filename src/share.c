@@ -0,0 +1,205 @@
+/** @brief Sealed memfd output implementation */
+#define _GNU_SOURCE /* memfd_create, fopencookie */
+#include "share.h"
+
+#include "grid.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define SHARE_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)
+
+
+/* Connect to a socket path, or take an inherited `fd:<n>`. */
+static int share_connect(const char *target) {
+    if (strncmp(target, "fd:", 3) == 0) {
+        char *end;
+        long fd = strtol(target + 3, &end, 10);
+        if (*end || end == target + 3 || fd < 0) {
+            fprintf(stderr, "Unable to use %s as a socket\n", target);
+            return -1;
+        }
+        return (int)fd;
+    }
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(target) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Unable to connect to %s: path too long\n", target);
+        return -1;
+    }
+    strcpy(addr.sun_path, target);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0 ||
+        connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "Unable to connect to %s\n", target);
+        if (sock >= 0) {
+            close(sock);
+        }
+        return -1;
+    }
+    return sock;
+}
+
+static int share_send(int sock, int fd, u64 size) {
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov = { .iov_base = &size, .iov_len = sizeof(size) };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    if (sendmsg(sock, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(size)) {
+        fprintf(stderr, "Unable to send output descriptor\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Output drawn into a mapping of fixed size. */
+struct share_map {
+    u8 *map;
+    size_t size;
+    size_t pos;
+};
+
+static ssize_t share_copy(void *cookie, const char *buf, size_t size) {
+    struct share_map *m = cookie;
+    if (size > m->size - m->pos) {
+        return -1;
+    }
+    memcpy(m->map + m->pos, buf, size);
+    m->pos += size;
+    return (ssize_t)size;
+}
+
+/**
+ * Draw a generated maze into `fd`: size the memfd to the exact size of the
+ * output, and draw into a shared mapping of it.
+ *
+ * @return Output size, or -1 on failure.
+ */
+static i64 share_draw_mapped(const struct maze_job *job, const grid *maze,
+                             int fd) {
+    TRACE_BEGIN("size");
+    const i64 size = (i64)job_size_band(job, maze, 0, 1);
+    TRACE_END("size");
+
+    if (ftruncate(fd, (off_t)size) != 0) {
+        fprintf(stderr, "Unable to size memfd to %lld bytes\n",
+                (long long)size);
+        return -1;
+    }
+    u8 *map = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Unable to map %lld bytes of output\n",
+                (long long)size);
+        return -1;
+    }
+
+    struct share_map m = { .map = map, .size = (size_t)size };
+    cookie_io_functions_t copy = { .write = share_copy };
+    i64 n = -1;
+    FILE *out = fopencookie(&m, "w", copy);
+    if (out != NULL) {
+        TRACE_BEGIN("render");
+        n = job_draw_band(job, maze, out, 0, 1);
+        TRACE_END("render");
+        if (fclose(out) != 0) {
+            n = -1;
+        }
+    }
+    munmap(map, (size_t)size);
+
+    if (n != size) {
+        fprintf(stderr, "Unable to draw output into memfd\n");
+        return -1;
+    }
+    return size;
+}
+
+/* Write any other output to `fd` as it comes. */
+static i64 share_write(const struct maze_job *job, int fd) {
+    int copy = dup(fd);
+    FILE *out = (copy >= 0) ? fdopen(copy, "wb") : NULL;
+    if (out == NULL) {
+        fprintf(stderr, "Unable to open memfd for writing\n");
+        if (copy >= 0) {
+            close(copy);
+        }
+        return -1;
+    }
+
+    i64 n = job_run(job, out, NULL);
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Unable to write output to memfd\n");
+        return -1;
+    }
+    return n;
+}
+
+int share_run(const struct maze_job *job, const char *target) {
+    int fd = memfd_create("svgmaze", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to create memfd\n");
+        return -1;
+    }
+
+    grid *maze = NULL;
+    i64 size;
+    int split = job_generate(job, &maze, NULL);
+    if (split > 0) {
+        size = share_draw_mapped(job, maze, fd);
+        grid_free(maze);
+    } else {
+        size = (split == 0) ? share_write(job, fd) : -1;
+    }
+
+    int err = (size < 0);
+    if (!err && fcntl(fd, F_ADD_SEALS, SHARE_SEALS) != 0) {
+        fprintf(stderr, "Unable to seal memfd\n");
+        err = 1;
+    }
+    if (!err) {
+        int sock = share_connect(target);
+        err = (sock < 0) || share_send(sock, fd, (u64)size) != 0;
+        if (sock >= 0 && strncmp(target, "fd:", 3) != 0) {
+            close(sock);
+        }
+    }
+    close(fd);
+    return err ? -1 : 0;
+}
+
+#else
+
+int share_run(const struct maze_job *job, const char *target) {
+    (void)job;
+    (void)target;
+    fprintf(stderr, "Unable to share output: memfd is Linux only\n");
+    return -1;
+}
+
+#endif /* __linux__ */
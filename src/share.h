@@ -0,0 +1,31 @@
+/**
+ * @brief Sealed memfd output
+ *
+ * Hand the output of a job to another process without copying it through a
+ * pipe: the output is drawn into an anonymous memory file, sealed against
+ * any further change, and its descriptor sent over a Unix socket with
+ * SCM_RIGHTS. The receiver can map it read only.
+ *
+ * The message carries the output size in bytes as a native endian u64, with
+ * the descriptor as ancillary data.
+ */
+#ifndef SHARE_H
+#define SHARE_H
+
+#include "types.h"
+#include "job.h"
+
+/**
+ * Run `job` into a sealed memfd and send it to `target`: the path of a
+ * listening Unix stream socket, or `fd:<n>` for an inherited, connected
+ * Unix socket.
+ *
+ * Svg and ascii output is sized up front without drawing it, and is then
+ * drawn straight into a mapping of exactly that size. Other output
+ * is written to the memfd as it is produced.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int share_run(const struct maze_job *job, const char *target);
+
+#endif /* SHARE_H */
@@ -0,0 +1,674 @@
+/** @brief Maze solvers implementation */
+#include "solve.h"
+
+#include "tmpfile.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Walk directions, as used by the generator: east, west, south, north. */
+static const int solve_dx[4] = {1, -1, 0, 0};
+static const int solve_dy[4] = {0, 0, 1, -1};
+
+struct solve_ends solve_ends_at(const struct solve_ends *ends, u32 columns,
+                                u32 rows) {
+    struct solve_ends at = *ends;
+    at.from_x = (at.from_x == SOLVE_LAST) ? columns - 1 : at.from_x;
+    at.from_y = (at.from_y == SOLVE_LAST) ? rows - 1 : at.from_y;
+    at.to_x = (at.to_x == SOLVE_LAST) ? columns - 1 : at.to_x;
+    at.to_y = (at.to_y == SOLVE_LAST) ? rows - 1 : at.to_y;
+    return at;
+}
+
+u64 solve_memory(const char *solver, u32 columns, u32 rows) {
+    const u64 cells = (u64)columns * rows;
+    const u64 open = ((u64)columns + rows) * sizeof(u64);
+    const u32 gw = columns * 2 + 1;
+    const u32 gh = rows * 2 + 1;
+
+    if (0 == strcmp("bfs", solver)) {
+        /* The solution is mapped and the levels go to a side file. */
+        return 2 * open;
+    }
+    if (0 == strcmp("fill", solver)) {
+        /* A guarded bit grid, reused as the solution, and a byte per word
+         * marking the queued ones. */
+        const u64 stride = grid_stride(gw, GRID_BITS);
+        return stride * ((u64)gh + 2) + stride / 8 * gh + open;
+    }
+    /* A bit grid solution, and a visited bit and 2 bit direction per cell
+     * for each side. */
+    return grid_cell_bytes(gw, gh, GRID_BITS) +
+           2 * ((cells + 63) / 64 * sizeof(u64) + (cells + 3) / 4 + open);
+}
+
+/**
+ * Open cells of one side, bucketed by how far their estimated path length
+ * exceeds the distance between the ends. Each step changes the estimate by
+ * 0 or 2, so bucket k holds estimates of distance + 2k, the lowest bucket in
+ * use never moves back, and a cell is only ever pushed to the lowest bucket
+ * or the one after it. Two buckets, reused in turn, hold every open cell.
+ */
+struct solve_bucket {
+    u64 *cells;
+    u64 len;
+    u64 cap;
+};
+
+struct solve_side {
+    /* Visited cells, one bit each. */
+    u64 *seen;
+    /* Direction taken into each visited cell, 2 bits each. */
+    u8 *from;
+
+    u32 origin_x;
+    u32 origin_y;
+    u32 goal_x;
+    u32 goal_y;
+
+    struct solve_bucket buckets[2];
+    u64 lowest;
+    u64 open;
+};
+
+static inline u32 solve_distance(u32 x0, u32 y0, u32 x1, u32 y1) {
+    return ((x0 > x1) ? x0 - x1 : x1 - x0) + ((y0 > y1) ? y0 - y1 : y1 - y0);
+}
+
+static inline int solve_seen(const struct solve_side *s, u64 i) {
+    return (s->seen[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void solve_visit(struct solve_side *s, u64 i, u32 dir) {
+    s->seen[i >> 6] |= 1ull << (i & 63);
+    s->from[i >> 2] |= (u8)(dir << ((i & 3) * 2));
+}
+
+static inline u32 solve_from(const struct solve_side *s, u64 i) {
+    return (s->from[i >> 2] >> ((i & 3) * 2)) & 3;
+}
+
+static int solve_push(struct solve_side *s, u64 key, u64 cell) {
+    struct solve_bucket *b = &s->buckets[key & 1];
+    if (b->len == b->cap) {
+        u64 cap = b->cap ? b->cap * 2 : 256;
+        u64 *grown = realloc(b->cells, cap * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        b->cells = grown;
+        b->cap = cap;
+    }
+    b->cells[b->len++] = cell;
+    ++s->open;
+    return 0;
+}
+
+/* Take the newest cell of the lowest bucket, which runs deepest first. */
+static u64 solve_pop(struct solve_side *s, u64 *key) {
+    if (s->buckets[s->lowest & 1].len == 0) {
+        ++s->lowest;
+    }
+    struct solve_bucket *b = &s->buckets[s->lowest & 1];
+    --s->open;
+    *key = s->lowest;
+    return b->cells[--b->len];
+}
+
+static void solve_side_free(struct solve_side *s) {
+    free(s->buckets[0].cells);
+    free(s->buckets[1].cells);
+    free(s->seen);
+    free(s->from);
+}
+
+/* Mark the path from cell `i` back to the origin of `s`. */
+static void solve_trace(grid *solution, const struct solve_side *s,
+                        u32 columns, u64 i) {
+    u32 x = (u32)(i % columns);
+    u32 y = (u32)(i / columns);
+    grid_set(solution, 2 * x + 1, 2 * y + 1, 1);
+    while (x != s->origin_x || y != s->origin_y) {
+        const u32 dir = solve_from(s, (u64)y * columns + x);
+        grid_set(solution, 2 * x + 1 - solve_dx[dir],
+                 2 * y + 1 - solve_dy[dir], 1);
+        x -= solve_dx[dir];
+        y -= solve_dy[dir];
+        grid_set(solution, 2 * x + 1, 2 * y + 1, 1);
+    }
+}
+
+grid* solve_astar(const grid *maze, const struct solve_ends *ends,
+                  u64 *visited) {
+    const u32 columns = maze->columns / 2;
+    const u32 rows = maze->rows / 2;
+    const u64 cells = (u64)columns * rows;
+    if (ends->from_x >= columns || ends->to_x >= columns ||
+        ends->from_y >= rows || ends->to_y >= rows) {
+        fprintf(stderr, "Unable to solve between cells outside the maze\n");
+        return NULL;
+    }
+
+    const u32 distance = solve_distance(ends->from_x, ends->from_y,
+                                        ends->to_x, ends->to_y);
+    struct solve_side sides[2] = {
+        {
+            .origin_x = ends->from_x, .origin_y = ends->from_y,
+            .goal_x = ends->to_x, .goal_y = ends->to_y,
+        },
+        {
+            .origin_x = ends->to_x, .origin_y = ends->to_y,
+            .goal_x = ends->from_x, .goal_y = ends->from_y,
+        },
+    };
+    grid *solution = grid_alloc_kind(maze->columns, maze->rows, 0, GRID_BITS);
+    int failed = (solution == NULL);
+    for (u32 k = 0; k < 2 && !failed; ++k) {
+        struct solve_side *s = &sides[k];
+        s->seen = calloc((cells + 63) / 64, sizeof(u64));
+        s->from = calloc((cells + 3) / 4, 1);
+        const u64 origin = (u64)s->origin_y * columns + s->origin_x;
+        failed = (s->seen == NULL || s->from == NULL ||
+                  solve_push(s, 0, origin) != 0);
+        if (!failed) {
+            solve_visit(s, origin, 0);
+        }
+    }
+
+    u64 count = 2;
+    int met = 0;
+    u64 meet = 0;
+    u32 meet_dir = 0;
+    u32 side = 0;
+    if (!failed && distance == 0) {
+        met = 1;
+        meet = (u64)ends->from_y * columns + ends->from_x;
+        meet_dir = 4;
+    }
+
+    while (!failed && !met) {
+        struct solve_side *s = &sides[side];
+        const struct solve_side *other = &sides[side ^ 1];
+        if (s->open == 0) {
+            break;
+        }
+
+        u64 key;
+        const u64 i = solve_pop(s, &key);
+        const u32 x = (u32)(i % columns);
+        const u32 y = (u32)(i / columns);
+        const u64 g = 2 * key + distance -
+                      solve_distance(x, y, s->goal_x, s->goal_y);
+
+        for (u32 dir = 0; dir < 4; ++dir) {
+            if (grid_get(maze, 2 * x + 1 + solve_dx[dir],
+                         2 * y + 1 + solve_dy[dir])) {
+                continue;
+            }
+            const u32 nx = x + solve_dx[dir];
+            const u32 ny = y + solve_dy[dir];
+            const u64 n = (u64)ny * columns + nx;
+            if (solve_seen(other, n)) {
+                met = 1;
+                meet = i;
+                meet_dir = dir;
+                break;
+            }
+            if (solve_seen(s, n)) {
+                continue;
+            }
+            solve_visit(s, n, dir);
+            ++count;
+            const u64 f = g + 1 + solve_distance(nx, ny, s->goal_x, s->goal_y);
+            if (solve_push(s, (f - distance) / 2, n) != 0) {
+                failed = 1;
+                break;
+            }
+        }
+        side ^= 1;
+    }
+
+    if (met) {
+        /* The meeting cell was expanded by the side before the switch. */
+        const u32 s = (meet_dir == 4) ? 0 : side ^ 1;
+        solve_trace(solution, &sides[s], columns, meet);
+        if (meet_dir != 4) {
+            const u32 x = (u32)(meet % columns);
+            const u32 y = (u32)(meet / columns);
+            grid_set(solution, 2 * x + 1 + solve_dx[meet_dir],
+                     2 * y + 1 + solve_dy[meet_dir], 1);
+            solve_trace(solution, &sides[s ^ 1], columns,
+                        (u64)(y + solve_dy[meet_dir]) * columns +
+                        (x + solve_dx[meet_dir]));
+        }
+    } else if (!failed) {
+        fprintf(stderr, "Unable to find a path between %u,%u and %u,%u\n",
+                ends->from_x, ends->from_y, ends->to_x, ends->to_y);
+    } else {
+        fprintf(stderr, "Unable to allocate memory for solving\n");
+    }
+
+    solve_side_free(&sides[0]);
+    solve_side_free(&sides[1]);
+    if (!met) {
+        grid_free(solution);
+        return NULL;
+    }
+    if (visited) {
+        *visited = count;
+    }
+    return solution;
+}
+
+/*
+ * External BFS. A level of the search is an array of entries, each a cell
+ * index shifted left by 2 with the direction taken into the cell from the
+ * level before. Sorted by cell, a level is expanded in one pass forward
+ * through the grid's storage. Each level is appended to a side file,
+ * followed by its length, so the path can be traced back by reading the
+ * levels in reverse.
+ */
+struct solve_level {
+    u64 *entries;
+    u64 len;
+    u64 cap;
+};
+
+static int solve_level_push(struct solve_level *l, u64 entry) {
+    if (l->len == l->cap) {
+        u64 cap = l->cap ? l->cap * 2 : 4096;
+        u64 *grown = realloc(l->entries, cap * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        l->entries = grown;
+        l->cap = cap;
+    }
+    l->entries[l->len++] = entry;
+    return 0;
+}
+
+static int solve_entry_order(const void *a, const void *b) {
+    const u64 x = *(const u64*)a >> 2;
+    const u64 y = *(const u64*)b >> 2;
+    return (x > y) - (x < y);
+}
+
+/* Side file in $TMPDIR, gone once closed. */
+static FILE* solve_side_file(void) {
+    int fd = tmp_fd("side file");
+    if (fd < 0) {
+        return NULL;
+    }
+    FILE *f = fdopen(fd, "w+b");
+    if (f == NULL) {
+        close(fd);
+    }
+    return f;
+}
+
+/* Direction into cell `cell` of the level ending at `*end`, which moves to
+ * the start of the level. */
+static int solve_level_find(FILE *side, u64 *end, struct solve_level *l,
+                            u64 cell, u32 *dir) {
+    u64 len;
+    if (*end < sizeof(len) || fseeko(side, (off_t)(*end - sizeof(len)),
+                                     SEEK_SET) != 0 ||
+        fread(&len, sizeof(len), 1, side) != 1) {
+        return -1;
+    }
+    *end -= sizeof(len) + len * sizeof(u64);
+    l->len = 0;
+    while (l->cap < len) {
+        if (solve_level_push(l, 0) != 0) {
+            return -1;
+        }
+    }
+    if (fseeko(side, (off_t)*end, SEEK_SET) != 0 ||
+        fread(l->entries, sizeof(u64), len, side) != len) {
+        return -1;
+    }
+
+    u64 lo = 0;
+    u64 hi = len;
+    while (lo < hi) {
+        const u64 mid = lo + (hi - lo) / 2;
+        if ((l->entries[mid] >> 2) < cell) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == len || (l->entries[lo] >> 2) != cell) {
+        return -1;
+    }
+    *dir = (u32)(l->entries[lo] & 3);
+    return 0;
+}
+
+grid* solve_bfs_external(const grid *maze, const struct solve_ends *ends,
+                         u64 *visited) {
+    const u32 columns = maze->columns / 2;
+    const u32 rows = maze->rows / 2;
+    if (ends->from_x >= columns || ends->to_x >= columns ||
+        ends->from_y >= rows || ends->to_y >= rows) {
+        fprintf(stderr, "Unable to solve between cells outside the maze\n");
+        return NULL;
+    }
+    const u64 origin = (u64)ends->from_y * columns + ends->from_x;
+    const u64 goal = (u64)ends->to_y * columns + ends->to_x;
+
+    FILE *side = solve_side_file();
+    struct solve_level level = {0};
+    struct solve_level next = {0};
+    int err = (side == NULL || solve_level_push(&level, origin << 2) != 0);
+    u64 count = 1;
+    u64 found = (origin == goal) ? origin << 2 : UINT64_MAX;
+    u64 depth = 0;
+
+    TRACE_BEGIN("solve levels");
+    while (!err && found == UINT64_MAX && level.len > 0) {
+        next.len = 0;
+        for (u64 k = 0; k < level.len && !err; ++k) {
+            const u64 i = level.entries[k] >> 2;
+            const u32 back = (u32)(level.entries[k] & 3) ^ 1;
+            const u32 x = (u32)(i % columns);
+            const u32 y = (u32)(i / columns);
+            for (u32 dir = 0; dir < 4; ++dir) {
+                /* A tree has no other way back to an earlier level. */
+                if ((depth > 0 && dir == back) ||
+                    grid_get(maze, 2 * x + 1 + solve_dx[dir],
+                             2 * y + 1 + solve_dy[dir])) {
+                    continue;
+                }
+                const u64 n = (u64)(y + solve_dy[dir]) * columns +
+                              (x + solve_dx[dir]);
+                if (n == goal) {
+                    found = n << 2 | dir;
+                }
+                err |= solve_level_push(&next, n << 2 | dir);
+            }
+        }
+
+        err |= (fwrite(level.entries, sizeof(u64), level.len, side) !=
+                level.len);
+        err |= (fwrite(&level.len, sizeof(level.len), 1, side) != 1);
+
+        qsort(next.entries, next.len, sizeof(u64), solve_entry_order);
+        count += next.len;
+        ++depth;
+        struct solve_level t = level;
+        level = next;
+        next = t;
+    }
+    TRACE_END("solve levels");
+
+    grid *solution = NULL;
+    if (!err && found != UINT64_MAX) {
+        solution = grid_alloc_kind(maze->columns, maze->rows, 0, GRID_MMAP);
+        err = (solution == NULL) || (fflush(side) != 0);
+    } else if (!err) {
+        fprintf(stderr, "Unable to find a path between %u,%u and %u,%u\n",
+                ends->from_x, ends->from_y, ends->to_x, ends->to_y);
+    }
+
+    /* Trace back through the levels, last first. */
+    TRACE_BEGIN("solve path");
+    u64 end = side ? (u64)ftello(side) : 0;
+    u64 cell = found >> 2;
+    u32 dir = (u32)(found & 3);
+    while (solution && !err) {
+        u32 x = (u32)(cell % columns);
+        u32 y = (u32)(cell / columns);
+        grid_set(solution, 2 * x + 1, 2 * y + 1, 1);
+        if (cell == origin) {
+            break;
+        }
+        grid_set(solution, 2 * x + 1 - solve_dx[dir],
+                 2 * y + 1 - solve_dy[dir], 1);
+        x -= solve_dx[dir];
+        y -= solve_dy[dir];
+        cell = (u64)y * columns + x;
+        err = solve_level_find(side, &end, &next, cell, &dir);
+    }
+    TRACE_END("solve path");
+
+    if (err) {
+        fprintf(stderr, "Unable to solve maze through side file\n");
+        grid_free(solution);
+        solution = NULL;
+    }
+    if (side) {
+        fclose(side);
+    }
+    free(level.entries);
+    free(next.entries);
+    if (solution && visited) {
+        *visited = count;
+    }
+    return solution;
+}
+
+/* Cells of a bit grid row, 64 to a word, cell 0 in the lowest bit. */
+static inline u64 fill_load(const u8 *row, u64 k) {
+    u64 w;
+    memcpy(&w, row + 8 * k, sizeof(w));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+static inline void fill_store(u8 *row, u64 k, u64 w) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    memcpy(row + 8 * k, &w, sizeof(w));
+}
+
+/* Words of a bit grid waiting to be tested again, and which are queued. */
+struct fill_queue {
+    u64 *words;
+    u64 len;
+    u64 cap;
+    u8 *queued;
+};
+
+static int fill_push(struct fill_queue *q, u64 word) {
+    if (q->queued[word]) {
+        return 0;
+    }
+    if (q->len == q->cap) {
+        u64 cap = q->cap ? q->cap * 2 : 4096;
+        u64 *grown = realloc(q->words, cap * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        q->words = grown;
+        q->cap = cap;
+    }
+    q->queued[word] = 1;
+    q->words[q->len++] = word;
+    return 0;
+}
+
+/**
+ * Fill the dead ends of word `k` of row `y` of `walls` until none are left.
+ * An open cell is a dead end if at least three of its neighbours are walls,
+ * unless it is in `kept`. `walls` is guarded, so the bit before word 0 is
+ * the wall at column -1 and the bit after the last word is never looked
+ * at, it lies past the guard wall at column `columns`.
+ *
+ * @return The cells filled.
+ */
+static u64 fill_word(grid *walls, u32 y, u64 k, u64 kept) {
+    u8 *row = grid_row(walls, y);
+    const u64 was = fill_load(row, k);
+    if (!~was) {
+        return 0;
+    }
+
+    const u64 carry = fill_load(row - 8, k) >> 63;
+    const u64 next = fill_load(row + 8, k) & 1;
+    const u64 u = fill_load(grid_row(walls, y - 1), k);
+    const u64 d = fill_load(grid_row(walls, y + 1), k);
+    u64 w = was;
+    /* Filling a cell can leave its neighbour in the word a dead end. */
+    for (;;) {
+        const u64 left = (w << 1) | carry;
+        const u64 right = (w >> 1) | (next << 63);
+        const u64 three = (left & right & (u | d)) |
+                          (u & d & (left | right));
+        const u64 dead = three & ~w & ~kept;
+        if (!dead) {
+            break;
+        }
+        w |= dead;
+    }
+    if (w != was) {
+        fill_store(row, k, w);
+    }
+    return w & ~was;
+}
+
+grid* solve_fill(const grid *maze, const struct solve_ends *ends,
+                 u64 *words) {
+    const u32 columns = maze->columns / 2;
+    const u32 rows = maze->rows / 2;
+    if (ends->from_x >= columns || ends->to_x >= columns ||
+        ends->from_y >= rows || ends->to_y >= rows) {
+        fprintf(stderr, "Unable to solve between cells outside the maze\n");
+        return NULL;
+    }
+
+    /* Walls all round, so words at the edges need no special cases. */
+    grid *walls = grid_alloc_guarded(maze->columns, maze->rows, 1,
+                                     GRID_BITS, 1);
+    const u64 n = walls ? walls->stride / 8 : 0;
+    struct fill_queue q = {
+        .queued = calloc((u64)maze->rows * (n ? n : 1), 1),
+    };
+    if (walls == NULL || q.queued == NULL) {
+        fprintf(stderr, "Unable to allocate memory for solving\n");
+        grid_free(walls);
+        free(q.queued);
+        return NULL;
+    }
+
+    TRACE_BEGIN("solve copy");
+    for (u32 y = 0; y < maze->rows; ++y) {
+        if (maze->kind == GRID_BITS) {
+            memcpy(grid_row(walls, y), grid_row(maze, y), walls->stride);
+            continue;
+        }
+        /* Gather the low bits of 8 cell bytes into one byte. */
+        const u8 *cells = grid_row(maze, y);
+        u8 *bits = grid_row(walls, y);
+        for (u32 x = 0; x + 8 <= maze->columns; x += 8) {
+            u64 v;
+            memcpy(&v, cells + x, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            v = __builtin_bswap64(v);
+#endif
+            bits[x / 8] = (u8)(((v & 0x0101010101010101ull) *
+                                0x0102040810204080ull) >> 56);
+        }
+        for (u32 x = maze->columns & ~7u; x < maze->columns; ++x) {
+            grid_set(walls, x, y, grid_get(maze, x, y));
+        }
+    }
+    TRACE_END("solve copy");
+
+    const u32 end_x[2] = {2 * ends->from_x + 1, 2 * ends->to_x + 1};
+    const u32 end_y[2] = {2 * ends->from_y + 1, 2 * ends->to_y + 1};
+
+    /*
+     * Test every word once, in order. A word that fills cells queues the
+     * words next to those cells, and the queue is drained, newest first,
+     * before moving on, so a dead end is followed along its corridor at
+     * once, whichever way it turns.
+     */
+    TRACE_BEGIN("solve fill");
+    u64 tests = 0;
+    int err = 0;
+    for (u32 y = 1; y + 1 < maze->rows && !err; ++y) {
+        for (u64 k = 0; k < n && !err; ++k) {
+            err = fill_push(&q, (u64)y * n + k);
+            while (q.len > 0 && !err) {
+                const u64 word = q.words[--q.len];
+                q.queued[word] = 0;
+                const u32 wy = (u32)(word / n);
+                const u64 wk = word % n;
+                u64 kept = 0;
+                for (u32 e = 0; e < 2; ++e) {
+                    if (wy == end_y[e] && wk == end_x[e] / 64) {
+                        kept |= 1ull << (end_x[e] % 64);
+                    }
+                }
+
+                const u64 filled = fill_word(walls, wy, wk, kept);
+                ++tests;
+                if (filled == 0) {
+                    continue;
+                }
+                /*
+                 * Only open neighbours can have become dead ends. Walls are
+                 * never filled, and the border and guard walls keep filled
+                 * cells off the first and last rows and off the ends of a
+                 * row, so the neighbouring words are always in the row or
+                 * the rows either side.
+                 */
+                const u64 up = fill_load(grid_row(walls, wy - 1), wk);
+                const u64 down = fill_load(grid_row(walls, wy + 1), wk);
+                if (filled & ~up) {
+                    err |= fill_push(&q, word - n);
+                }
+                if (filled & ~down) {
+                    err |= fill_push(&q, word + n);
+                }
+                if (filled & 1) {
+                    err |= fill_push(&q, word - 1);
+                }
+                if (filled >> 63) {
+                    err |= fill_push(&q, word + 1);
+                }
+            }
+        }
+    }
+    TRACE_END("solve fill");
+
+    free(q.words);
+    free(q.queued);
+    if (err) {
+        fprintf(stderr, "Unable to allocate memory for solving\n");
+        grid_free(walls);
+        return NULL;
+    }
+
+    /* What is left open is the solution. */
+    for (u32 y = 0; y < walls->rows; ++y) {
+        u8 *row = grid_row(walls, y);
+        for (u64 k = 0; k < walls->stride; ++k) {
+            row[k] = (u8)~row[k];
+        }
+    }
+
+    if (words) {
+        *words = tests;
+    }
+    return walls;
+}
+
+u64 solve_draw_ascii(FILE *out, const grid *maze, const grid *solution) {
+    u64 n = 0;
+    for (u32 y = 0; y < maze->rows; ++y) {
+        for (u32 x = 0; x < maze->columns; ++x) {
+            fputc(grid_get(maze, x, y) ? '#'
+                  : grid_get(solution, x, y) ? '.' : ' ', out);
+        }
+        fputc('\n', out);
+        n += (u64)maze->columns + 1;
+    }
+    return n;
+}
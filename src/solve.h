@@ -0,0 +1,102 @@
+/**
+ * @brief Maze solvers
+ *
+ * Find the path between two corridor cells of a perfect maze. A solution is
+ * a bit grid the size of the maze grid with the path's corridor cells and
+ * the openings between them set, so it can be drawn over the maze by any
+ * output that walks the grid.
+ */
+#ifndef SOLVE_H
+#define SOLVE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "types.h"
+#include "grid.h"
+
+/** End coordinate standing for the last column or row of a maze. */
+#define SOLVE_LAST UINT32_MAX
+
+/** Ends of a path, as corridor cells. */
+struct solve_ends {
+    u32 from_x;
+    u32 from_y;
+    u32 to_x;
+    u32 to_y;
+};
+
+/**
+ * The ends of `ends` in a maze of `columns` x `rows` corridors, with
+ * SOLVE_LAST replaced by the last column or row.
+ */
+struct solve_ends solve_ends_at(const struct solve_ends *ends, u32 columns,
+                                u32 rows);
+
+/**
+ * Estimate the bytes of memory `solver` (astar|fill|bfs) needs to solve a
+ * maze of `columns` x `rows` corridors, solution included, on top of the
+ * maze. Every cell is counted where a solver keeps per cell state. Open
+ * cells, search levels and queued words are taken as `columns` + `rows`
+ * at a time, well above what the generator's mazes need.
+ */
+u64 solve_memory(const char *solver, u32 columns, u32 rows);
+
+/**
+ * Find the path between the ends of `ends` with a bidirectional A* search,
+ * guided towards each end by the Manhattan distance. Each side keeps its
+ * open cells in buckets of equal estimated length and its visited cells in
+ * a bitset, and the search stops as soon as the two sides meet. A perfect
+ * maze has only one path, so the first meeting gives it. Working memory is
+ * zero filled on demand, so only the pages of cells visited are touched.
+ *
+ * If `visited` is not NULL it gets the number of cells the search visited.
+ *
+ * @return Solution grid, or NULL if the ends are not joined or memory could
+ *         not be allocated. Free it with `grid_free`.
+ */
+grid* solve_astar(const grid *maze, const struct solve_ends *ends,
+                  u64 *visited);
+
+/**
+ * Find the path between the ends of `ends` with a breadth first search
+ * suited to grids mapped from a file larger than memory. Each level of the
+ * search is sorted by cell, so it is expanded in a single pass forward
+ * through the grid's storage, and appended to a side file in $TMPDIR. Once
+ * the far end is reached, the path is traced back by reading the levels in
+ * reverse, and the solution is a mapped grid too. In a perfect maze only
+ * the cell a search came from can lead back, so no visited cells are kept.
+ *
+ * If `visited` is not NULL it gets the number of cells the search visited.
+ *
+ * @return Solution grid, or NULL if the ends are not joined or the search
+ *         failed. Free it with `grid_free`.
+ */
+grid* solve_bfs_external(const grid *maze, const struct solve_ends *ends,
+                         u64 *visited);
+
+/**
+ * Find the path between the ends of `ends` by dead end filling: any open
+ * cell other than an end with walls on three sides is walled up, until no
+ * such cell is left, leaving only the path. Cells are tested and filled 64
+ * at a time with bitwise operations on the rows of a bit grid. After one
+ * pass over every word, only the words next to cells just filled are
+ * tested again. Every cell is covered, so this suits ends far apart.
+ *
+ * If `words` is not NULL it gets the number of times a word was tested.
+ *
+ * @return Solution grid, or NULL if memory could not be allocated. Free it
+ *         with `grid_free`.
+ */
+grid* solve_fill(const grid *maze, const struct solve_ends *ends,
+                 u64 *words);
+
+/**
+ * Draw `maze` to `out` as ASCII like `maze_draw_ascii`, with the cells of
+ * `solution` drawn as '.'.
+ *
+ * @return Number of bytes written.
+ */
+u64 solve_draw_ascii(FILE *out, const grid *maze, const grid *solution);
+
+#endif /* SOLVE_H */
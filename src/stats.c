@@ -0,0 +1,175 @@
+/** @brief Latency histograms and batch metrics implementation */
+#include "stats.h"
+
+#include "timer.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/*
+ * Values below 2^(SUB_BITS + 1) get a bucket each, above that every power of
+ * two is split into 2^SUB_BITS buckets, keeping relative error under 1.6%.
+ * That is 2 * 2^SUB_BITS buckets, then 2^SUB_BITS for each of the powers of
+ * two from SUB_BITS + 1 to 63.
+ */
+#define SUB_BITS 6
+#define SUB_COUNT (1u << SUB_BITS)
+#define BUCKETS ((65 - SUB_BITS) * SUB_COUNT)
+
+/**
+ * Counters have a single writer, their owning thread, which updates them
+ * with plain relaxed loads and stores. Reports read them concurrently.
+ */
+struct histogram {
+    _Atomic u64 max;
+    _Atomic u64 counts[BUCKETS];
+};
+
+struct stats {
+    struct stats *next;
+    _Atomic u64 mazes;
+    _Atomic u64 bytes;
+    struct histogram hist[STATS_METRICS];
+};
+
+static const char *metric_names[STATS_METRICS] = {
+    "generate", "render", "write", "total"
+};
+
+static u64 stats_epoch = 0;
+static _Atomic(struct stats *) stats_list = NULL;
+static _Thread_local struct stats *stats_local = NULL;
+
+
+static inline void counter_add(_Atomic u64 *c, u64 v) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v,
+                          memory_order_relaxed);
+}
+
+static inline u64 counter_get(_Atomic u64 *c) {
+    return atomic_load_explicit(c, memory_order_relaxed);
+}
+
+static u32 bucket_index(u64 v) {
+    if (v < 2 * SUB_COUNT) {
+        return (u32)v;
+    }
+    u32 shift = (63 - (u32)__builtin_clzll(v)) - SUB_BITS;
+    return (shift + 1) * SUB_COUNT + (u32)((v >> shift) - SUB_COUNT);
+}
+
+/* Highest value that falls in bucket `k`. */
+static u64 bucket_value(u32 k) {
+    if (k < 2 * SUB_COUNT) {
+        return k;
+    }
+    u32 shift = k / SUB_COUNT - 1;
+    return (((u64)(k % SUB_COUNT + SUB_COUNT) + 1) << shift) - 1;
+}
+
+void stats_start(void) {
+    stats_epoch = timer_ns();
+}
+
+struct stats* stats_thread(void) {
+    struct stats *st = stats_local;
+    if (st != NULL) {
+        return st;
+    }
+
+    st = calloc(1, sizeof(struct stats));
+    if (st == NULL) {
+        return NULL;
+    }
+    st->next = atomic_load(&stats_list);
+    while (!atomic_compare_exchange_weak(&stats_list, &st->next, st)) {
+    }
+
+    stats_local = st;
+    return st;
+}
+
+void stats_record(struct stats *st, enum stats_metric metric, u64 ns) {
+    struct histogram *h = &st->hist[metric];
+    counter_add(&h->counts[bucket_index(ns)], 1);
+    if (ns > counter_get(&h->max)) {
+        atomic_store_explicit(&h->max, ns, memory_order_relaxed);
+    }
+}
+
+void stats_maze(struct stats *st, u64 bytes) {
+    counter_add(&st->mazes, 1);
+    counter_add(&st->bytes, bytes);
+}
+
+/* Value at percentile `p` of a merged histogram holding `total` values. */
+static u64 percentile(const u64 *counts, u64 total, u64 max, double p) {
+    u64 rank = (u64)(p * (double)total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    u64 seen = 0;
+    for (u32 k = 0; k < BUCKETS; ++k) {
+        seen += counts[k];
+        if (seen >= rank) {
+            u64 v = bucket_value(k);
+            return (v < max) ? v : max;
+        }
+    }
+    return max;
+}
+
+void stats_report(FILE *out) {
+    u64 *counts = malloc(sizeof(u64) * BUCKETS);
+    if (counts == NULL) {
+        return;
+    }
+
+    u64 mazes = 0;
+    u64 bytes = 0;
+    for (struct stats *st = atomic_load(&stats_list); st; st = st->next) {
+        mazes += counter_get(&st->mazes);
+        bytes += counter_get(&st->bytes);
+    }
+    double seconds = (double)(timer_ns() - stats_epoch) / 1e9;
+
+    fprintf(out, "{\"mazes\":%llu,\"bytes\":%llu,\"seconds\":%.6f,"
+            "\"mazes_per_sec\":%.3f,\"bytes_per_sec\":%.1f,\"latency_ns\":{",
+            (unsigned long long)mazes, (unsigned long long)bytes, seconds,
+            seconds > 0 ? (double)mazes / seconds : 0.0,
+            seconds > 0 ? (double)bytes / seconds : 0.0);
+
+    for (u32 m = 0; m < STATS_METRICS; ++m) {
+        u64 total = 0;
+        u64 max = 0;
+        for (u32 k = 0; k < BUCKETS; ++k) {
+            counts[k] = 0;
+        }
+        for (struct stats *st = atomic_load(&stats_list); st; st = st->next) {
+            struct histogram *h = &st->hist[m];
+            for (u32 k = 0; k < BUCKETS; ++k) {
+                u64 c = counter_get(&h->counts[k]);
+                counts[k] += c;
+                total += c;
+            }
+            if (counter_get(&h->max) > max) {
+                max = counter_get(&h->max);
+            }
+        }
+
+        fprintf(out, "%s\"%s\":{\"count\":%llu", m ? "," : "",
+                metric_names[m], (unsigned long long)total);
+        if (total > 0) {
+            fprintf(out, ",\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu",
+                    (unsigned long long)percentile(counts, total, max, 0.50),
+                    (unsigned long long)percentile(counts, total, max, 0.90),
+                    (unsigned long long)percentile(counts, total, max, 0.99),
+                    (unsigned long long)max);
+        }
+        fputc('}', out);
+    }
+
+    fprintf(out, "}}\n");
+    fflush(out);
+    free(counts);
+}
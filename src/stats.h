@@ -0,0 +1,46 @@
+/**
+ * @brief Latency histograms and batch metrics
+ *
+ * Each thread records into its own log-linear (HDR style) histograms, so
+ * recording never contends. Histograms are merged when a report is made.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#include "types.h"
+
+enum stats_metric {
+    STATS_GENERATE,
+    STATS_RENDER,
+    STATS_WRITE,
+    STATS_TOTAL,
+    STATS_METRICS
+};
+
+struct stats;
+
+/**
+ * Start the clock for throughput reporting. Call once before any thread
+ * records.
+ */
+void stats_start(void);
+
+/** Histograms of the calling thread, or NULL if they cannot be allocated. */
+struct stats* stats_thread(void);
+
+/** Record a latency of `ns` nanoseconds for `metric`. */
+void stats_record(struct stats *st, enum stats_metric metric, u64 ns);
+
+/** Count a completed maze of `bytes` bytes. */
+void stats_maze(struct stats *st, u64 bytes);
+
+/**
+ * Merge the histograms of every thread and write percentiles, throughput
+ * and bytes written to `out` as a JSON object. Safe to call while other
+ * threads are recording.
+ */
+void stats_report(FILE *out);
+
+#endif /* STATS_H */
@@ -0,0 +1,358 @@
+/** @brief Row streaming maze generator implementation */
+#include "stream.h"
+
+#include "prng.h"
+#include "rowsolve.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NO_SET UINT32_MAX
+
+/* Rows per traced band of a streamed render. */
+#define TRACE_BAND 1024
+
+/* Close the previous traced band and open the next at each band start. */
+static void stream_trace_band(u32 y) {
+    if (y % TRACE_BAND == 0) {
+        if (y > 0) {
+            TRACE_END("rows");
+        }
+        TRACE_BEGIN_ARG("rows", y);
+    }
+}
+
+/* Sets are tracked with a union-find over the labels of the current row. */
+static u32 set_find(u32 *parent, u32 s) {
+    while (parent[s] != s) {
+        parent[s] = parent[parent[s]];
+        s = parent[s];
+    }
+    return s;
+}
+
+u64 maze_stream_bytes(u32 columns) {
+    return (u64)columns * (4 * sizeof(u32) + 3 * sizeof(u8));
+}
+
+int maze_stream_open(struct maze_stream *ms, u32 columns, u32 rows) {
+    ms->columns = columns;
+    ms->rows = rows;
+    ms->y = NO_SET;
+
+    ms->east = malloc(columns);
+    ms->south = malloc(columns);
+    ms->down = malloc(columns);
+    ms->sets = malloc(sizeof(u32) * columns);
+    ms->parent = malloc(sizeof(u32) * columns);
+    ms->last = malloc(sizeof(u32) * columns);
+    ms->remap = malloc(sizeof(u32) * columns);
+    if (!ms->east || !ms->south || !ms->down || !ms->sets ||
+        !ms->parent || !ms->last || !ms->remap) {
+        fprintf(stderr, "Unable to allocate memory for %u column stream\n",
+                columns);
+        maze_stream_close(ms);
+        return -1;
+    }
+
+    /* Before the first row, every cell is in a set of its own. */
+    for (u32 x = 0; x < columns; ++x) {
+        ms->sets[x] = x;
+        ms->south[x] = 0;
+    }
+    return 0;
+}
+
+int maze_stream_next(struct maze_stream *ms) {
+    const u32 columns = ms->columns;
+    const u32 y = ms->y + 1;
+    if (y >= ms->rows) {
+        return 0;
+    }
+    ms->y = y;
+    const int last_row = (y + 1 == ms->rows);
+
+    /* Carry sets down through the open south walls of the previous row,
+     * cells below a wall start a new set. Carried sets are renumbered first
+     * so that fresh labels follow on and every label stays below `columns`.
+     */
+    u32 *parent = ms->parent;
+    for (u32 x = 0; x < columns; ++x) {
+        parent[x] = x;
+    }
+    for (u32 x = 0; x < columns; ++x) {
+        ms->remap[x] = NO_SET;
+    }
+    for (u32 x = 0; x < columns; ++x) {
+        if (ms->south[x]) {
+            ms->sets[x] = NO_SET;
+        }
+    }
+    u32 used = 0;
+    for (u32 x = 0; x < columns; ++x) {
+        if (ms->sets[x] != NO_SET) {
+            if (ms->remap[ms->sets[x]] == NO_SET) {
+                ms->remap[ms->sets[x]] = used++;
+            }
+            ms->sets[x] = ms->remap[ms->sets[x]];
+        }
+    }
+    for (u32 x = 0; x < columns; ++x) {
+        if (ms->sets[x] == NO_SET) {
+            ms->sets[x] = used++;
+        }
+    }
+
+    /* Randomly join neighbouring cells in different sets, joining every
+     * set on the final row so the maze is connected. */
+    for (u32 x = 0; x + 1 < columns; ++x) {
+        u32 a = set_find(parent, ms->sets[x]);
+        u32 b = set_find(parent, ms->sets[x + 1]);
+        ms->east[x] = 1;
+        if (a != b && (last_row || (prng_nextuint() % 2))) {
+            parent[b] = a;
+            ms->east[x] = 0;
+        }
+    }
+    ms->east[columns - 1] = 1;
+
+    /* Renumber sets by first appearance. */
+    for (u32 x = 0; x < columns; ++x) {
+        ms->remap[x] = NO_SET;
+    }
+    used = 0;
+    for (u32 x = 0; x < columns; ++x) {
+        u32 s = set_find(parent, ms->sets[x]);
+        if (ms->remap[s] == NO_SET) {
+            ms->remap[s] = used++;
+        }
+        ms->sets[x] = ms->remap[s];
+    }
+
+    if (last_row) {
+        for (u32 x = 0; x < columns; ++x) {
+            ms->south[x] = 1;
+        }
+        return 1;
+    }
+
+    /* Every set continues down at least once: randomly open south walls,
+     * forcing one open at the last cell of a set that has none. */
+    for (u32 x = columns; x-- > 0;) {
+        ms->last[ms->sets[x]] = NO_SET;
+    }
+    for (u32 x = columns; x-- > 0;) {
+        if (ms->last[ms->sets[x]] == NO_SET) {
+            ms->last[ms->sets[x]] = x;
+        }
+    }
+    u8 *down = ms->down;
+    for (u32 s = 0; s < used; ++s) {
+        down[s] = 0;
+    }
+    for (u32 x = 0; x < columns; ++x) {
+        const u32 s = ms->sets[x];
+        u8 open = (prng_nextuint() % 2) ||
+                  (!down[s] && ms->last[s] == x);
+        ms->south[x] = !open;
+        down[s] |= open;
+    }
+
+    return 1;
+}
+
+void maze_stream_close(struct maze_stream *ms) {
+    free(ms->east);
+    free(ms->south);
+    free(ms->down);
+    free(ms->sets);
+    free(ms->parent);
+    free(ms->last);
+    free(ms->remap);
+    ms->east = ms->south = ms->down = NULL;
+    ms->sets = ms->parent = ms->last = ms->remap = NULL;
+}
+
+/**
+ * Print streamed maze as ASCII or UTF-8 characters to `out`.
+ */
+i64 maze_stream_draw_ascii(FILE *out, u32 columns, u32 rows,
+                           const char *fg, const char *bg,
+                           struct rowsolve *solution) {
+    struct maze_stream ms;
+    if (maze_stream_open(&ms, columns, rows) != 0) {
+        return -1;
+    }
+
+    i64 n = 0;
+    for (u32 x = 0; x < 2 * columns + 1; ++x) {
+        n += fprintf(out, "%s", fg);
+    }
+    n += fprintf(out, "\n");
+
+    while (maze_stream_next(&ms)) {
+        stream_trace_band(ms.y);
+        if (solution && rowsolve_next(solution) != 1) {
+            n = -1;
+            break;
+        }
+        n += fprintf(out, "%s", fg);
+        for (u32 x = 0; x < columns; ++x) {
+            const char *cell = (solution && solution->cells[x]) ? "." : bg;
+            const char *pass = (solution && solution->east[x]) ? "." : bg;
+            n += fprintf(out, "%s%s", cell, ms.east[x] ? fg : pass);
+        }
+        n += fprintf(out, "\n%s", fg);
+        for (u32 x = 0; x < columns; ++x) {
+            const char *pass = (solution && solution->south[x]) ? "." : bg;
+            n += fprintf(out, "%s%s", ms.south[x] ? fg : pass, fg);
+        }
+        n += fprintf(out, "\n");
+    }
+    TRACE_END("rows");
+
+    maze_stream_close(&ms);
+    return n;
+}
+
+static int svg_line(FILE *out, u32 x1, u32 y1, u32 x2, u32 y2) {
+    return fprintf(out, "<line x1='%u' y1='%u' x2='%u' y2='%u'/>",
+                   x1, y1, x2, y2);
+}
+
+/**
+ * Lines through the middle of the solution's straight runs, in half pixel
+ * units like `maze_draw_svg`. `open` gives the start row of the vertical run
+ * on each column.
+ */
+static i64 stream_solution_svg(FILE *out, struct rowsolve *solution,
+                               const struct svg_opts *opts, u32 *open) {
+    const u32 columns = solution->columns;
+    const u32 cw = opts->corridor_width;
+    i64 n = fprintf(out,
+                    "<g stroke-linecap='round' stroke-width='%u' "
+                    "stroke='" SVG_SOLUTION_COLOR "' "
+                    "transform='scale(.5)'>", 2 * opts->pen_radius);
+    for (u32 x = 0; x < columns; ++x) {
+        open[x] = NO_SET;
+    }
+
+    int got;
+    while ((got = rowsolve_next(solution)) == 1) {
+        const u32 cy = (2 * solution->y + 1) * cw;
+        for (u32 x = 0; x < columns; ++x) {
+            if (solution->cells[x] && solution->east[x] &&
+                (x == 0 || !solution->east[x - 1])) {
+                u32 x2 = x;
+                while (solution->east[x2]) {
+                    ++x2;
+                }
+                n += svg_line(out, (2 * x + 1) * cw, cy,
+                              (2 * x2 + 1) * cw, cy);
+            }
+
+            if (solution->south[x] && open[x] == NO_SET) {
+                open[x] = solution->y;
+            } else if (!solution->south[x] && open[x] != NO_SET) {
+                n += svg_line(out, (2 * x + 1) * cw, (2 * open[x] + 1) * cw,
+                              (2 * x + 1) * cw, cy);
+                open[x] = NO_SET;
+            }
+        }
+    }
+    n += fprintf(out, "</g>");
+    return (got < 0) ? -1 : n;
+}
+
+/**
+ * Render streamed maze as an SVG document to `out`.
+ */
+i64 maze_stream_draw_svg(FILE *out, u32 columns, u32 rows,
+                         struct svg_opts *opts, struct rowsolve *solution) {
+    struct maze_stream ms;
+    if (maze_stream_open(&ms, columns, rows) != 0) {
+        return -1;
+    }
+
+    /* Start row of the open vertical line on each wall column. */
+    u32 *open = malloc(sizeof(u32) * (columns + 1));
+    if (open == NULL) {
+        fprintf(stderr, "Unable to allocate memory for %u column stream\n",
+                columns);
+        maze_stream_close(&ms);
+        return -1;
+    }
+
+    const u32 cw = opts->corridor_width;
+    i64 n = 0;
+    n += fprintf(out, "<?xml version='1.0' standalone='no'?>\n");
+    n += fprintf(out,
+                 "<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 %u %u'>",
+                 columns * cw, rows * cw);
+    n += fprintf(out,
+                 "<g stroke-linecap='round' stroke-width='%u' stroke='%s'>",
+                 opts->pen_radius, opts->fg_color);
+
+    /* The top wall is solid, and starts every vertical line. */
+    n += svg_line(out, 0, 0, columns * cw, 0);
+    for (u32 x = 0; x <= columns; ++x) {
+        open[x] = 0;
+    }
+
+    while (maze_stream_next(&ms)) {
+        const u32 y = ms.y;
+        stream_trace_band(y);
+
+        /* Vertical lines end where the row has no wall to the west. */
+        for (u32 x = 1; x < columns; ++x) {
+            if (!ms.east[x - 1] && open[x] != NO_SET) {
+                if (y > open[x]) {
+                    n += svg_line(out, x * cw, open[x] * cw, x * cw, y * cw);
+                }
+                open[x] = NO_SET;
+            }
+        }
+
+        /* Horizontal lines along the south side of the row. */
+        u32 x1 = 0;
+        for (u32 x = 0; x < columns; ++x) {
+            if (!ms.south[x]) {
+                if (x > x1) {
+                    n += svg_line(out, x1 * cw, (y + 1) * cw,
+                                  x * cw, (y + 1) * cw);
+                }
+                x1 = x + 1;
+            }
+        }
+        if (columns > x1) {
+            n += svg_line(out, x1 * cw, (y + 1) * cw,
+                          columns * cw, (y + 1) * cw);
+        }
+
+        /* Every wall post on the south side starts or continues a line. */
+        for (u32 x = 0; x <= columns; ++x) {
+            if (open[x] == NO_SET) {
+                open[x] = y + 1;
+            }
+        }
+    }
+
+    TRACE_END("rows");
+
+    for (u32 x = 0; x <= columns; ++x) {
+        if (rows > open[x]) {
+            n += svg_line(out, x * cw, open[x] * cw, x * cw, rows * cw);
+        }
+    }
+
+    n += fprintf(out, "</g>");
+    i64 drawn = 0;
+    if (solution) {
+        drawn = stream_solution_svg(out, solution, opts, open);
+    }
+    n += fprintf(out, "</svg>\n");
+
+    free(open);
+    maze_stream_close(&ms);
+    return (drawn < 0) ? -1 : n + drawn;
+}
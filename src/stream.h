@@ -0,0 +1,85 @@
+/**
+ * @brief Row streaming maze generator
+ *
+ * Generates a maze one row at a time using Eller's algorithm, so memory
+ * is proportional to the maze width rather than its area. The mazes differ
+ * from `maze_generate` for the same seed since the algorithm is different.
+ */
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "types.h"
+#include "maze.h"
+
+struct rowsolve;
+
+struct maze_stream {
+    u32 columns;
+    u32 rows;
+    /** Index of the row most recently produced by `maze_stream_next`. */
+    u32 y;
+
+    /** Wall to the east of each cell of the current row. */
+    u8 *east;
+    /** Wall to the south of each cell of the current row. */
+    u8 *south;
+    /**
+     * Connected set of each cell of the current row, considering only the
+     * rows produced so far. Sets are numbered in order of first appearance.
+     */
+    u32 *sets;
+
+    /* Working storage */
+    u32 *parent;
+    u32 *last;
+    u32 *remap;
+    u8 *down;
+};
+
+/**
+ * Bytes of working memory needed to stream a maze `columns` wide.
+ */
+u64 maze_stream_bytes(u32 columns);
+
+/**
+ * Prepare to stream a maze of `columns` x `rows` corridors.
+ *
+ * @return 0 on success, -1 if memory could not be allocated.
+ */
+int maze_stream_open(struct maze_stream *ms, u32 columns, u32 rows);
+
+/**
+ * Generate the next row of the maze into `ms->east`, `ms->south` and
+ * `ms->sets`.
+ *
+ * @return 1 if a row was produced, 0 once all rows have been produced.
+ */
+int maze_stream_next(struct maze_stream *ms);
+
+/** Free the working memory of a maze stream. */
+void maze_stream_close(struct maze_stream *ms);
+
+/**
+ * Generate a maze of `columns` x `rows` corridors row by row and draw it to
+ * `out` as ASCII, as `maze_draw_ascii` would. If `solution` is not NULL,
+ * its rows are read alongside and drawn as '.', like `solve_draw_ascii`.
+ *
+ * @return Number of bytes written, or -1 on failure.
+ */
+i64 maze_stream_draw_ascii(FILE *out, u32 columns, u32 rows,
+                           const char *fg, const char *bg,
+                           struct rowsolve *solution);
+
+/**
+ * Generate a maze of `columns` x `rows` corridors row by row and draw it to
+ * `out` as an SVG document, as `maze_draw_svg` would. Vertical lines are
+ * written as soon as they end rather than after all of the horizontal lines.
+ * If `solution` is not NULL, its rows are read after the walls are drawn
+ * and drawn over them.
+ *
+ * @return Number of bytes written, or -1 on failure.
+ */
+i64 maze_stream_draw_svg(FILE *out, u32 columns, u32 rows,
+                         struct svg_opts *opts, struct rowsolve *solution);
+
+#endif /* STREAM_H */
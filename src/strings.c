@@ -1,6 +1,9 @@
 /** @brief String functions implementation */
 #include "strings.h"
 
+#include <errno.h>
+#include <stdlib.h>
+
 
 u64 strhash(const char *const str) {
     u64 hash = 57;
@@ -11,3 +14,65 @@ u64 strhash(const char *const str) {
 
     return hash;
 }
+
+int strsize(const char *const str, u64 *size) {
+    if (*str < '0' || *str > '9') {
+        return -1;
+    }
+    char *end;
+    errno = 0;
+    const u64 n = strtoull(str, &end, 10);
+    if (errno == ERANGE) {
+        return -1;
+    }
+
+    u32 shift = 0;
+    switch (*end) {
+    case 'G': case 'g':
+        shift = 30;
+        break;
+    case 'M': case 'm':
+        shift = 20;
+        break;
+    case 'K': case 'k':
+        shift = 10;
+        break;
+    default:
+        break;
+    }
+    if (shift) {
+        ++end;
+    }
+
+    if (*end != '\0' || n > (UINT64_MAX >> shift)) {
+        return -1;
+    }
+    *size = n << shift;
+    return 0;
+}
+
+int strrange(const char *const str, u64 *first, u64 *last) {
+    const char *p = str;
+    while (*p >= '0' && *p <= '9') {
+        ++p;
+    }
+    if (p == str || p[0] != '.' || p[1] != '.') {
+        return 1;
+    }
+
+    char *end;
+    errno = 0;
+    u64 a = strtoull(str, &end, 10);
+    const char *rest = end + 2;
+    /* strtoull would take a sign or spaces, which are not a range. */
+    if (*rest < '0' || *rest > '9') {
+        return -1;
+    }
+    u64 b = strtoull(rest, &end, 10);
+    if (errno == ERANGE || *end != '\0' || b < a) {
+        return -1;
+    }
+    *first = a;
+    *last = b;
+    return 0;
+}
@@ -9,4 +9,21 @@
 /** Simple hashing function for C string. */
 u64 strhash(const char *str);
 
+/**
+ * Parse a byte count with an optional K, M or G (binary) suffix into `size`.
+ *
+ * @return 0 on success, -1 if `str` is not a valid size or does not fit in
+ *         64 bits.
+ */
+int strsize(const char *str, u64 *size);
+
+/**
+ * Parse an inclusive range of integers `first..last` into `first` and
+ * `last`. Any string starting with digits then ".." is taken for a range.
+ *
+ * @return 0 on success, 1 if `str` is not a range, -1 if it looks like one
+ *         but is not valid: reversed, out of range or with trailing text.
+ */
+int strrange(const char *str, u64 *first, u64 *last);
+
 #endif /* STRINGS_H */
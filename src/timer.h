@@ -0,0 +1,18 @@
+/**
+ * @brief Monotonic clock
+ */
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <time.h>
+
+#include "types.h"
+
+/** Current monotonic time in nanoseconds. */
+static inline u64 timer_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+#endif /* TIMER_H */
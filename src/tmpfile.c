@@ -0,0 +1,21 @@
+/** @brief Temporary files implementation */
+#include "tmpfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+int tmp_fd(const char *what) {
+    const char *dir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/svgmaze-XXXXXX", dir ? dir : "/tmp");
+
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to create %s %s\n", what, path);
+        return -1;
+    }
+    unlink(path);
+    return fd;
+}
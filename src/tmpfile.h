@@ -0,0 +1,19 @@
+/**
+ * @brief Temporary files
+ *
+ * Scratch files for data kept out of memory: mapped grids, solution logs
+ * and search levels.
+ */
+#ifndef TMPFILE_H
+#define TMPFILE_H
+
+/**
+ * Create a temporary file in $TMPDIR, or /tmp, and unlink it at once, so
+ * it disappears once the returned descriptor and any mappings of it are
+ * closed. `what` names the file in the error message.
+ *
+ * @return File descriptor, or -1 if the file could not be created.
+ */
+int tmp_fd(const char *what);
+
+#endif /* TMPFILE_H */
@@ -0,0 +1,146 @@
+/** @brief Timeline tracing implementation */
+#include "trace.h"
+
+#include "timer.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Events kept per thread, older events are overwritten once full. */
+#define TRACE_RING_SIZE (1u << 16)
+
+struct trace_event {
+    u64 ts;
+    u64 arg;
+    const char *name;
+    char phase;
+};
+
+/**
+ * Each thread only writes its own ring, publishing with a release store of
+ * `head`, so recording never takes a lock. Rings are pushed onto a global
+ * list when a thread records its first event and are never freed.
+ */
+struct trace_ring {
+    struct trace_ring *next;
+    u32 tid;
+    const char *thread_name;
+    _Atomic u64 head;
+    struct trace_event events[TRACE_RING_SIZE];
+};
+
+int trace_enabled = 0;
+
+static FILE *trace_file = NULL;
+static u64 trace_epoch = 0;
+static _Atomic(struct trace_ring *) trace_rings = NULL;
+static atomic_uint trace_next_tid = 1;
+static _Thread_local struct trace_ring *trace_local = NULL;
+
+
+static struct trace_ring* trace_ring_get(void) {
+    struct trace_ring *ring = trace_local;
+    if (ring != NULL) {
+        return ring;
+    }
+
+    ring = calloc(1, sizeof(struct trace_ring));
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->tid = atomic_fetch_add(&trace_next_tid, 1);
+    ring->next = atomic_load(&trace_rings);
+    while (!atomic_compare_exchange_weak(&trace_rings, &ring->next, ring)) {
+    }
+
+    trace_local = ring;
+    return ring;
+}
+
+static void trace_record(const char *name, u64 arg, char phase) {
+    struct trace_ring *ring = trace_ring_get();
+    if (ring == NULL) {
+        return;
+    }
+
+    u64 head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    struct trace_event *ev = &ring->events[head % TRACE_RING_SIZE];
+    ev->ts = timer_ns();
+    ev->arg = arg;
+    ev->name = name;
+    ev->phase = phase;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+int trace_open(const char *path) {
+    trace_file = fopen(path, "w");
+    if (trace_file == NULL) {
+        fprintf(stderr, "Unable to open trace file %s\n", path);
+        return -1;
+    }
+
+    trace_epoch = timer_ns();
+    trace_enabled = 1;
+    trace_thread_name("main");
+    atexit(trace_close);
+    return 0;
+}
+
+void trace_begin(const char *name, u64 arg) {
+    trace_record(name, arg, 'B');
+}
+
+void trace_end(const char *name) {
+    trace_record(name, 0, 'E');
+}
+
+void trace_thread_name(const char *name) {
+    struct trace_ring *ring = trace_ring_get();
+    if (ring != NULL) {
+        ring->thread_name = name;
+    }
+}
+
+void trace_close(void) {
+    if (trace_file == NULL) {
+        return;
+    }
+    trace_enabled = 0;
+
+    const int pid = (int)getpid();
+    const char *sep = "";
+    fprintf(trace_file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    for (struct trace_ring *ring = atomic_load(&trace_rings);
+         ring != NULL; ring = ring->next) {
+        if (ring->thread_name) {
+            fprintf(trace_file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\","
+                    "\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    sep, pid, ring->tid, ring->thread_name);
+            sep = ",";
+        }
+
+        u64 head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        u64 first = (head > TRACE_RING_SIZE) ? head - TRACE_RING_SIZE : 0;
+        for (u64 k = first; k < head; ++k) {
+            const struct trace_event *ev = &ring->events[k % TRACE_RING_SIZE];
+            u64 ts = ev->ts - trace_epoch;
+            fprintf(trace_file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\","
+                    "\"ts\":%llu.%03u,\"pid\":%d,\"tid\":%u",
+                    sep, ev->name, ev->phase,
+                    (unsigned long long)(ts / 1000), (unsigned)(ts % 1000),
+                    pid, ring->tid);
+            if (ev->phase == 'B' && ev->arg) {
+                fprintf(trace_file, ",\"args\":{\"n\":%llu}",
+                        (unsigned long long)ev->arg);
+            }
+            fputc('}', trace_file);
+            sep = ",";
+        }
+    }
+
+    fprintf(trace_file, "\n]}\n");
+    fclose(trace_file);
+    trace_file = NULL;
+}
@@ -0,0 +1,45 @@
+/**
+ * @brief Timeline tracing
+ *
+ * Record begin/end events per thread and write them as a Chrome trace
+ * event JSON file (loadable in chrome://tracing or Perfetto) at exit.
+ * When tracing is not enabled the TRACE_* macros cost a single branch.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+
+/** Non-zero once `trace_open` has succeeded. */
+extern int trace_enabled;
+
+/**
+ * Enable tracing. Events are written to `path` when the program exits.
+ *
+ * @return 0 on success, -1 if `path` cannot be written.
+ */
+int trace_open(const char *path);
+
+/**
+ * Record the start of `name` on the calling thread. `name` must be a
+ * string literal (only the pointer is kept), `arg` is shown with the event.
+ */
+void trace_begin(const char *name, u64 arg);
+
+/** Record the end of the most recent `name` on the calling thread. */
+void trace_end(const char *name);
+
+/** Label the calling thread in the timeline. */
+void trace_thread_name(const char *name);
+
+/** Write the recorded events out. Called at exit by `trace_open`. */
+void trace_close(void);
+
+#define TRACE_BEGIN(name)       \
+    do { if (trace_enabled) trace_begin((name), 0); } while (0)
+#define TRACE_BEGIN_ARG(name, arg)  \
+    do { if (trace_enabled) trace_begin((name), (arg)); } while (0)
+#define TRACE_END(name)         \
+    do { if (trace_enabled) trace_end(name); } while (0)
+
+#endif /* TRACE_H */
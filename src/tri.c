@@ -0,0 +1,276 @@
+/** @brief Triangular (delta) mazes implementation */
+#include "tri.h"
+
+#include "prng.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Nibble bit marking a cell visited during generation. */
+#define TRI_SEEN 8
+
+/* Walk directions: to the left and right neighbours, across the base. */
+#define DIR_LEFT 0
+#define DIR_RIGHT 1
+#define DIR_BASE 2
+
+/* Walk stack frame: tried directions in the low bits, entry direction in
+ * bits 4-5, as in the rectangular walk. */
+#define FRAME_TRIED 0x07
+#define FRAME_DIR(f) (((f) >> 4) & 3)
+
+static const u8 dir_wall[3] = {TRI_LEFT, TRI_RIGHT, TRI_BASE};
+static const u8 dir_back[3] = {DIR_RIGHT, DIR_LEFT, DIR_BASE};
+
+
+static inline u8 tri_get(const tri_grid *t, u32 x, u32 y) {
+    const u64 i = (u64)y * t->columns + x;
+    return (t->cells[i >> 1] >> ((i & 1) * 4)) & 0xF;
+}
+
+static inline void tri_clear(tri_grid *t, u32 x, u32 y, u8 bits) {
+    const u64 i = (u64)y * t->columns + x;
+    t->cells[i >> 1] &= (u8)~(bits << ((i & 1) * 4));
+}
+
+static inline void tri_mark(tri_grid *t, u32 x, u32 y) {
+    const u64 i = (u64)y * t->columns + x;
+    t->cells[i >> 1] |= (u8)(TRI_SEEN << ((i & 1) * 4));
+}
+
+/* Neighbour of `x`, `y` in direction `dir`, returns 0 if out of bounds. */
+static int tri_step(const tri_grid *t, u32 x, u32 y, u32 dir,
+                    u32 *nx, u32 *ny) {
+    *nx = x;
+    *ny = y;
+    switch (dir) {
+    case DIR_LEFT:
+        if (x == 0) {
+            return 0;
+        }
+        *nx = x - 1;
+        return 1;
+    case DIR_RIGHT:
+        if (x + 1 >= t->columns) {
+            return 0;
+        }
+        *nx = x + 1;
+        return 1;
+    default:
+        if (tri_up(x, y)) {
+            if (y + 1 >= t->rows) {
+                return 0;
+            }
+            *ny = y + 1;
+            return 1;
+        }
+        if (y == 0) {
+            return 0;
+        }
+        *ny = y - 1;
+        return 1;
+    }
+}
+
+tri_grid* tri_generate(u32 columns, u32 rows) {
+    /* A single column is a stack of separate diamonds. */
+    if (columns < 2 && rows > 2) {
+        fprintf(stderr, "Unable to connect a triangular maze 1 cell wide\n");
+        return NULL;
+    }
+
+    tri_grid *t = malloc(sizeof(tri_grid));
+    if (t == NULL) {
+        fprintf(stderr, "Unable to allocate memory for grid struct\n");
+        return NULL;
+    }
+    const u64 cells = (u64)columns * rows;
+    t->columns = columns;
+    t->rows = rows;
+    t->cells = malloc((cells + 1) / 2);
+    u64 cap = 4096;
+    u8 *stack = malloc(cap);
+    if (t->cells == NULL || stack == NULL) {
+        fprintf(stderr, "Unable to allocate memory for %ux%u triangles\n",
+                columns, rows);
+        free(stack);
+        tri_free(t);
+        return NULL;
+    }
+    /* Every wall up, nothing visited. */
+    memset(t->cells, 0x77, (cells + 1) / 2);
+
+    u32 x = prng_nextuint() % columns;
+    u32 y = prng_nextuint() % rows;
+    u64 depth = 0;
+    tri_mark(t, x, y);
+    stack[depth++] = 0;
+
+    while (depth > 0) {
+        u8 *frame = &stack[depth - 1];
+
+        if ((*frame & FRAME_TRIED) == FRAME_TRIED) {
+            if (--depth > 0) {
+                u32 px, py;
+                tri_step(t, x, y, dir_back[FRAME_DIR(*frame)], &px, &py);
+                x = px;
+                y = py;
+            }
+            continue;
+        }
+
+        u32 r = prng_nextuint() % 3;
+        while (*frame & (1u << r)) {
+            r = prng_nextuint() % 3;
+        }
+        *frame |= (u8)(1u << r);
+
+        u32 nx, ny;
+        if (!tri_step(t, x, y, r, &nx, &ny) ||
+            (tri_get(t, nx, ny) & TRI_SEEN)) {
+            continue;
+        }
+
+        tri_clear(t, x, y, dir_wall[r]);
+        tri_clear(t, nx, ny, dir_wall[dir_back[r]]);
+        tri_mark(t, nx, ny);
+
+        if (depth == cap) {
+            u8 *grown = realloc(stack, cap * 2);
+            if (grown == NULL) {
+                fprintf(stderr, "Unable to allocate memory for maze walk\n");
+                free(stack);
+                tri_free(t);
+                return NULL;
+            }
+            stack = grown;
+            cap *= 2;
+        }
+        stack[depth++] = (u8)(r << 4);
+        x = nx;
+        y = ny;
+    }
+
+    free(stack);
+    return t;
+}
+
+void tri_free(tri_grid *t) {
+    if (t != NULL) {
+        free(t->cells);
+        free(t);
+    }
+}
+
+/*
+ * Geometry: with u the corridor width, column x of a row spans x*u to
+ * (x+2)*u and rows are h = u*sqrt(3) tall. The edge between cells k-1 and
+ * k of row y (k = 0 and k = columns being the outer walls) runs from k*u
+ * at one side of the row to (k+1)*u at the other. It slopes down to the
+ * right ("\") when k+y is odd and down to the left ("/") otherwise, and
+ * continues on the next row as edge k+1 or k-1 respectively.
+ */
+
+/* Wall between cells k-1 and k of row y. */
+static inline int tri_edge(const tri_grid *t, u32 k, u32 y) {
+    if (k == 0 || k == t->columns) {
+        return 1;
+    }
+    return (tri_walls(t, k - 1, y) & TRI_RIGHT) != 0;
+}
+
+/* Wall along row line y, under column x of row y-1 / over x of row y. */
+static inline int tri_base(const tri_grid *t, u32 x, u32 y) {
+    return (tri_walls(t, x, (y < t->rows) ? y : y - 1) & TRI_BASE) != 0;
+}
+
+static int tri_line(FILE *out, u32 x1, u32 y1, u32 x2, u32 y2) {
+    return fprintf(out, "<line x1='%u' y1='%u' x2='%u' y2='%u'/>",
+                   x1, y1, x2, y2);
+}
+
+u64 tri_draw_svg(FILE *out, const tri_grid *t, const struct svg_opts *opts) {
+    const u32 u = opts->corridor_width;
+    const u32 h = (u32)(u * 1.7320508 + 0.5);
+    const u32 columns = t->columns;
+    const u32 rows = t->rows;
+    u64 n = 0;
+
+    n += fprintf(out, "<?xml version='1.0' standalone='no'?>\n");
+    n += fprintf(out,
+                 "<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 %u %u'>",
+                 (columns + 1) * u, rows * h);
+    n += fprintf(out, "<g stroke-linecap='round' stroke-linejoin='round' "
+                 "stroke-width='%u' stroke='%s'>",
+                 opts->pen_radius, opts->fg_color);
+
+    /* Row lines: the horizontal edges on line y belong to the columns
+     * where x+y is odd, each ending where the next begins. */
+    for (u32 y = 0; y <= rows; ++y) {
+        u32 run = UINT32_MAX;
+        u32 x = (y & 1) ? 0 : 1;
+        for (; x < columns; x += 2) {
+            if (tri_base(t, x, y)) {
+                run = (run == UINT32_MAX) ? x : run;
+                continue;
+            }
+            if (run != UINT32_MAX) {
+                n += tri_line(out, run * u, y * h, x * u, y * h);
+                run = UINT32_MAX;
+            }
+        }
+        if (run != UINT32_MAX) {
+            n += tri_line(out, run * u, y * h, x * u, y * h);
+        }
+    }
+
+    /* "\" diagonals: k - y = d is constant and odd. */
+    for (i64 d = -(i64)rows + 1; d <= (i64)columns; ++d) {
+        if ((d & 1) == 0) {
+            continue;
+        }
+        u32 y = (d < 0) ? (u32)-d : 0;
+        u32 run = UINT32_MAX;
+        for (; y < rows && (i64)y + d <= (i64)columns; ++y) {
+            const u32 k = (u32)((i64)y + d);
+            if (tri_edge(t, k, y)) {
+                run = (run == UINT32_MAX) ? y : run;
+                continue;
+            }
+            if (run != UINT32_MAX) {
+                n += tri_line(out, (u32)((i64)run + d) * u, run * h,
+                              k * u, y * h);
+                run = UINT32_MAX;
+            }
+        }
+        if (run != UINT32_MAX) {
+            n += tri_line(out, (u32)((i64)run + d) * u, run * h,
+                          (u32)((i64)y + d) * u, y * h);
+        }
+    }
+
+    /* "/" diagonals: k + y = s is constant and even. */
+    for (u64 s = 0; s <= (u64)columns + rows; s += 2) {
+        u32 y = (s > columns) ? (u32)(s - columns) : 0;
+        u32 run = UINT32_MAX;
+        for (; y < rows && y <= s; ++y) {
+            const u32 k = (u32)(s - y);
+            if (tri_edge(t, k, y)) {
+                run = (run == UINT32_MAX) ? y : run;
+                continue;
+            }
+            if (run != UINT32_MAX) {
+                n += tri_line(out, (u32)(s - run + 1) * u, run * h,
+                              (k + 1) * u, y * h);
+                run = UINT32_MAX;
+            }
+        }
+        if (run != UINT32_MAX) {
+            n += tri_line(out, (u32)(s - run + 1) * u, run * h,
+                          (u32)(s - y + 1) * u, y * h);
+        }
+    }
+
+    n += fprintf(out, "</g>");
+    n += fprintf(out, "</svg>\n");
+    return n;
+}
@@ -0,0 +1,63 @@
+/**
+ * @brief Triangular (delta) mazes
+ *
+ * Cells are triangles in rows, alternately pointing up and down. A cell
+ * points up when its column plus row is even, so orientation comes from
+ * parity and is never stored. Each cell holds three wall bits in a nibble
+ * of a row-major packed array: left edge, right edge and the horizontal
+ * edge (below an up cell, above a down cell).
+ */
+#ifndef TRI_H
+#define TRI_H
+
+#include <stdio.h>
+
+#include "types.h"
+#include "maze.h"
+
+#define TRI_LEFT 1
+#define TRI_RIGHT 2
+#define TRI_BASE 4
+
+typedef struct {
+    u32 columns;
+    u32 rows;
+    /** Two cells per byte, even columns in the low nibble. */
+    u8 *cells;
+} tri_grid;
+
+/** Non-zero if the cell at `x`, `y` points up. */
+static inline int tri_up(u32 x, u32 y) {
+    return ((x + y) & 1) == 0;
+}
+
+/** Wall bits of the cell at `x`, `y`. */
+static inline u8 tri_walls(const tri_grid *t, u32 x, u32 y) {
+    const u64 i = (u64)y * t->columns + x;
+    return (t->cells[i >> 1] >> ((i & 1) * 4)) & 7;
+}
+
+/**
+ * Generate a maze of `columns` x `rows` triangular cells with a depth first
+ * random walk. It is the responsibility of the caller to free the grid.
+ *
+ * @return tri_grid* Pointer to the maze, or NULL if memory could not be
+ *                   allocated or the maze cannot be connected (one column
+ *                   of more than two rows).
+ */
+tri_grid* tri_generate(u32 columns, u32 rows);
+
+/** Free a triangular maze. */
+void tri_free(tri_grid *t);
+
+/**
+ * Draw a triangular maze to `out` as an SVG document. Triangles have sides
+ * of twice `opts.corridor_width`. Collinear walls are merged into single
+ * lines across cells, along the rows and both diagonals, so the document
+ * grows with the number of wall runs rather than cells.
+ *
+ * @return u64 Number of bytes written.
+ */
+u64 tri_draw_svg(FILE *out, const tri_grid *t, const struct svg_opts *opts);
+
+#endif /* TRI_H */
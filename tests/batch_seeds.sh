@@ -0,0 +1,40 @@
+#!/bin/sh
+# Check that every maze of a batch is the maze its seed gives on its own.
+#
+#   tests/batch_seeds.sh [svgmaze]
+#
+# A few mazes large enough for their grid to be filled on the pool run
+# alongside many small ones, so that waiting workers pick up other mazes in
+# the middle of generating their own. Each is compared with the same seed
+# run alone on one thread.
+set -eu
+
+SVGMAZE=${1:-./build/svgmaze}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cat > "$TMP/jobs.txt" <<EOF
+2048x2048 1..3
+8x8 1..500
+EOF
+
+mkdir "$TMP/batch" "$TMP/alone"
+"$SVGMAZE" -oarc --jobs="$TMP/jobs.txt" -j8 -d"$TMP/batch" > /dev/null
+
+fail=0
+# check <columns> <rows> <seed>: compare a batch maze with its seed alone
+check() {
+    "$SVGMAZE" -oarc -w"$1" -h"$2" -r"$3..$3" -j1 -d"$TMP/alone" > /dev/null
+    if ! cmp -s "$TMP/alone/$3.arc" "$TMP/batch/$1x$2-$3.arc"; then
+        echo "$1x$2 seed $3 differs from the seed run alone"
+        fail=1
+    fi
+}
+
+for seed in 1 2 3; do
+    check 2048 2048 $seed
+done
+for seed in 1 2 250 499 500; do
+    check 8 8 $seed
+done
+exit $fail